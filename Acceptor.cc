@@ -4,6 +4,9 @@
 #include "Channel.h"
 #include "InetAddress.h"
 #include <sys/socket.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 
 static int createNonblocking() {
@@ -19,9 +22,12 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
     , acceptSocket_(createNonblocking())
     , acceptChannel_(loop, acceptSocket_.fd())
     , listenning_(false) 
+    , acceptBatch_(kDefaultAcceptBatch)
+    , idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
+    , suppressedErrors_(0)
 { 
-    acceptSocket_.setReusePort(true);
-    acceptSocket_.setReusePort(true);
+    acceptSocket_.setReuseAddr(true);
+    acceptSocket_.setReusePort(reuseport);
     acceptSocket_.bindAddress(listenAddr);
     acceptChannel_.setReadCallback(std::bind(&Acceptor::headleRead, this));
 }
@@ -29,7 +35,10 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
 Acceptor::~Acceptor() {
     acceptChannel_.disableAll();
     acceptChannel_.remove();
-    ::close(acceptSocket_.fd());
+    // acceptSocket_析构时会close，这里不能再close一次，否则可能关掉其他线程刚拿到的同号fd
+    if(idleFd_ >= 0) {
+        ::close(idleFd_);
+    }
 }
 
 void Acceptor::listen() {
@@ -38,19 +47,64 @@ void Acceptor::listen() {
     acceptChannel_.enableReading();
 }
 
+// 一次可读事件中循环accept，直到EAGAIN或者达到acceptBatch_，连接风暴时减少epoll的往返次数
 void Acceptor::headleRead() {
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if(connfd >= 0) {
-        if(newConnectionCallback_) {
-            // 轮询找到subLoop并分发fd
-            newConnectionCallback_(connfd, peerAddr);
+    int accepted = 0;
+    for(int i = 0; i < acceptBatch_; i++) {
+        InetAddress peerAddr;
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if(connfd >= 0) {
+            if(newConnectionCallback_) {
+                // 轮询找到subLoop并分发fd
+                newConnectionCallback_(connfd, peerAddr);
+                accepted++;
+            }
+            else {
+                ::close(connfd);
+            }
+            continue;
+        }
+
+        int savedErrno = errno;
+        if(savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+            break;  // backlog已经取完
         }
-        else {
-            ::close(connfd);
+        else if(savedErrno == EINTR || savedErrno == ECONNABORTED) {
+            continue;
         }
+        logAcceptError(savedErrno);
+        if(savedErrno == EMFILE || savedErrno == ENFILE) {
+            // 不处理的话监听fd一直可读，水平触发模式下loop会空转
+            dropConnection();
+            continue;
+        }
+        break;
+    }
+
+    if(accepted > 0 && batchEndCallback_) {
+        batchEndCallback_();
     }
-    else {
-        LOG_ERROR("accept error\n");
+}
+
+void Acceptor::dropConnection() {
+    if(idleFd_ < 0) {
+        return;
+    }
+    ::close(idleFd_);
+    int connfd = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+    if(connfd >= 0) {
+        ::close(connfd);
+    }
+    idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+void Acceptor::logAcceptError(int err) {
+    Timestamp now(loop_->now());
+    if(timeDifference(now, lastErrorLog_) < 1.0) {
+        suppressedErrors_++;
+        return;
     }
+    LOG_ERROR("accept error: %d, %d similar errors suppressed\n", err, suppressedErrors_);
+    lastErrorLog_ = now;
+    suppressedErrors_ = 0;
 }
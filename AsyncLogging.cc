@@ -0,0 +1,138 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include "Timestamp.h"
+
+#include <stdio.h>
+#include <chrono>
+
+AsyncLogging::AsyncLogging(const std::string& basename, off_t rollSize, int flushInterval)
+    : flushInterval_(flushInterval)
+    , running_(false)
+    , basename_(basename)
+    , rollSize_(rollSize)
+    , thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging")
+    , currentBuffer_(new LogBuffer)
+    , nextBuffer_(new LogBuffer)
+    , droppedMessages_(0)
+{
+    buffers_.reserve(kMaxQueuedBuffers);
+}
+
+AsyncLogging::~AsyncLogging() {
+    if(running_) {
+        stop();
+    }
+}
+
+void AsyncLogging::start() {
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop() {
+    running_ = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.notify_one();
+    }
+    thread_.join();
+}
+
+void AsyncLogging::append(const char* logline, int len) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(currentBuffer_->avail() > len) {
+        currentBuffer_->append(logline, len);
+        return;
+    }
+
+    if(buffers_.size() >= kMaxQueuedBuffers) {
+        // 后台线程跟不上，丢弃而不是阻塞前端
+        droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffers_.push_back(std::move(currentBuffer_));
+    if(nextBuffer_) {
+        currentBuffer_ = std::move(nextBuffer_);
+    }
+    else {
+        // 两块缓冲区都用完了，积压的总量受kMaxQueuedBuffers限制
+        currentBuffer_.reset(new LogBuffer);
+    }
+    currentBuffer_->append(logline, len);
+    cond_.notify_one();
+}
+
+void AsyncLogging::threadFunc() {
+    LogFile output(basename_, rollSize_, flushInterval_);
+    BufferPtr newBuffer1(new LogBuffer);
+    BufferPtr newBuffer2(new LogBuffer);
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(kMaxQueuedBuffers + 1);
+    uint64_t reportedDropped = 0;
+
+    while(running_) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if(buffers_.empty()) {
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            // 当前缓冲区不管有没有写满都交换出来，前端换上预先分配好的缓冲区
+            buffers_.push_back(std::move(currentBuffer_));
+            currentBuffer_ = std::move(newBuffer1);
+            buffersToWrite.swap(buffers_);
+            if(!nextBuffer_) {
+                nextBuffer_ = std::move(newBuffer2);
+            }
+        }
+
+        uint64_t dropped = droppedMessages();
+        if(dropped != reportedDropped) {
+            char buf[256];
+            int n = snprintf(buf, sizeof(buf), "Dropped %lu log messages at %s\n",
+                             static_cast<unsigned long>(dropped - reportedDropped),
+                             Timestamp::now().toString().c_str());
+            fputs(buf, stderr);
+            output.append(buf, n);
+            reportedDropped = dropped;
+        }
+
+        for(const BufferPtr& buffer : buffersToWrite) {
+            output.append(buffer->data(), buffer->length());
+        }
+
+        // 留两块缓冲区下次用，其余的释放
+        if(buffersToWrite.size() > 2) {
+            buffersToWrite.resize(2);
+        }
+        if(!newBuffer1) {
+            newBuffer1 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer1->reset();
+        }
+        if(!newBuffer2) {
+            if(buffersToWrite.empty()) {
+                newBuffer2.reset(new LogBuffer);
+            }
+            else {
+                newBuffer2 = std::move(buffersToWrite.back());
+                buffersToWrite.pop_back();
+                newBuffer2->reset();
+            }
+        }
+        buffersToWrite.clear();
+        output.flush();
+    }
+
+    // 退出前把剩下的日志写完
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        buffers_.push_back(std::move(currentBuffer_));
+        currentBuffer_ = std::move(newBuffer1);     // stop之后再append不会访问空指针
+        buffersToWrite.swap(buffers_);
+    }
+    for(const BufferPtr& buffer : buffersToWrite) {
+        output.append(buffer->data(), buffer->length());
+    }
+    output.flush();
+}
@@ -0,0 +1,79 @@
+#ifndef __ASYNCLOGGING_H__
+#define __ASYNCLOGGING_H__
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string.h>
+#include <sys/types.h>
+
+/*
+ 异步日志后端，双缓冲
+ 前端(各个IO线程)调用append把日志拷贝进currentBuffer_，写满后换上nextBuffer_
+ 后台线程被唤醒或者每flushInterval秒醒来一次，把写满的缓冲区整体交换出来写入LogFile
+ 前端只在拷贝时持锁，不做IO；积压的缓冲区达到上限时直接丢弃并计数，不会阻塞IO线程
+
+ 用法：
+   static AsyncLogging* g_asyncLog;
+   void asyncOutput(const char* msg, int len) { g_asyncLog->append(msg, len); }
+   ...
+   g_asyncLog->start();
+   Logger::setOutput(asyncOutput);
+*/
+class AsyncLogging : noncopyable {
+public:
+    AsyncLogging(const std::string& basename, off_t rollSize, int flushInterval = 3);
+    ~AsyncLogging();
+
+    void append(const char* logline, int len);
+
+    void start();
+    void stop();
+
+    // 因为后台来不及写而被丢弃的日志条数
+    uint64_t droppedMessages() const { return droppedMessages_.load(std::memory_order_relaxed); }
+
+private:
+    static const int kBufferSize = 4*1024*1024;
+    static const size_t kMaxQueuedBuffers = 16;     // 最多积压64MB，再多就丢弃
+
+    // 定长缓冲区
+    class LogBuffer : noncopyable {
+    public:
+        LogBuffer() : cur_(data_) {}
+
+        void append(const char* buf, size_t len) { memcpy(cur_, buf, len); cur_ += len; }
+        const char* data() const { return data_; }
+        int length() const { return static_cast<int>(cur_ - data_); }
+        int avail() const { return static_cast<int>(data_ + sizeof(data_) - cur_); }
+        void reset() { cur_ = data_; }
+    private:
+        char data_[kBufferSize];
+        char* cur_;
+    };
+
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    void threadFunc();
+
+    const int flushInterval_;
+    std::atomic<bool> running_;
+    const std::string basename_;
+    const off_t rollSize_;
+    Thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    BufferPtr currentBuffer_;
+    BufferPtr nextBuffer_;
+    BufferVector buffers_;      // 写满等待后台写入的缓冲区
+    std::atomic<uint64_t> droppedMessages_;
+};
+
+#endif
@@ -0,0 +1,364 @@
+#include "BinaryLogging.h"
+#include "CurrentThread.h"
+
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+#include <errno.h>
+
+__thread BinaryLogging::StagingBuffer* BinaryLogging::t_stagingBuffer = nullptr;
+
+namespace {
+
+struct Site {
+    LogLevel level;
+    const char* file;
+    int line;
+    const char* fmt;
+    const uint8_t* types;
+    size_t numArgs;
+};
+
+// 全局状态，调用点与缓冲区的注册都很少发生，用一把锁保护
+struct BinaryLogState {
+    BinaryLogState() : retiredDropped(0), threadActive(false), running(false), fp(nullptr), writtenSites(0), dropped(0) {}
+
+    std::mutex mutex;
+    std::vector<Site> sites;
+    std::vector<BinaryLogging::StagingBuffer*> buffers;
+    uint64_t retiredDropped;    // 已经释放的缓冲区的丢弃条数，以及缓冲区退休之后的日志条数
+    bool threadActive;          // 后台线程是否在运行(会访问buffers中的缓冲区)，start到stop之间为true
+
+    // 只有后台线程访问
+    std::atomic<bool> running;
+    std::thread thread;
+    FILE* fp;
+    size_t writtenSites;    // 已经写入文件的调用点个数
+    uint64_t dropped;       // 已经写入文件的丢弃条数
+};
+
+BinaryLogState& state() {
+    static BinaryLogState* s = new BinaryLogState;  // 不析构，线程退出时仍可以访问
+    return *s;
+}
+
+int64_t realtimeNs() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 线程退出时把它的缓冲区标记为退休，由后台线程读空后释放
+struct StagingBufferRetirer {
+    BinaryLogging::StagingBuffer* buffer = nullptr;
+    ~StagingBufferRetirer() {
+        if(buffer != nullptr) {
+            BinaryLogging::retire(buffer);
+        }
+    }
+};
+
+thread_local StagingBufferRetirer t_retirer;
+// 本线程的缓冲区已经退休，t_retirer可能已经析构，不能再创建缓冲区
+__thread bool t_retired = false;
+
+void writeBytes(FILE* fp, const void* data, size_t len) {
+    ::fwrite_unlocked(data, 1, len, fp);
+}
+
+void writeU32(FILE* fp, uint32_t v) {
+    writeBytes(fp, &v, sizeof(v));
+}
+
+void writeKind(FILE* fp, blogfile::EntryKind kind) {
+    uint8_t k = kind;
+    writeBytes(fp, &k, 1);
+}
+
+// 把新注册的调用点写入文件，必须在写这些调用点的记录之前调用
+void writeNewSites(BinaryLogState& s) {
+    std::vector<Site> sites;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        sites.assign(s.sites.begin() + s.writtenSites, s.sites.end());
+    }
+    for(const Site& site : sites) {
+        writeKind(s.fp, blogfile::kSiteDef);
+        writeU32(s.fp, static_cast<uint32_t>(s.writtenSites++));
+        writeU32(s.fp, static_cast<uint32_t>(site.level));
+        writeU32(s.fp, static_cast<uint32_t>(site.line));
+        writeU32(s.fp, static_cast<uint32_t>(site.numArgs));
+        writeBytes(s.fp, site.types, site.numArgs);
+        uint32_t fileLen = static_cast<uint32_t>(strlen(site.file));
+        writeU32(s.fp, fileLen);
+        writeBytes(s.fp, site.file, fileLen);
+        uint32_t fmtLen = static_cast<uint32_t>(strlen(site.fmt));
+        writeU32(s.fp, fmtLen);
+        writeBytes(s.fp, site.fmt, fmtLen);
+    }
+}
+
+} // namespace
+
+BinaryLogging::StagingBuffer::StagingBuffer(pid_t tid)
+    : writePos_(0)
+    , minFree_(0)
+    , committed_(0)
+    , dropped_(0)
+    , readPos_(0)
+    , retired_(false)
+    , tid_(tid)
+    , data_(new char[kStagingBufferSize])
+{}
+
+BinaryLogging::StagingBuffer::~StagingBuffer() {
+    delete[] data_;
+}
+
+/*
+ writePos_ == readPos_ 表示缓冲区为空，所以写入后writePos_不能追上readPos_，两者之间至少留8字节
+ 尾部放不下时在writePos_处写一个kWrapMarker，从头开始写；恰好写到结尾时不需要标记
+*/
+char* BinaryLogging::StagingBuffer::reserveSlow(size_t n) {
+    size_t r = readPos_.load(std::memory_order_acquire);
+    size_t w = writePos_;
+    if(w >= r) {
+        minFree_ = kStagingBufferSize - w;
+        if(minFree_ >= n) {
+            return data_ + w;
+        }
+        if(r >= n + 8) {
+            if(w < kStagingBufferSize) {
+                uint32_t marker = kWrapMarker;
+                memcpy(data_ + w, &marker, sizeof(marker));
+            }
+            writePos_ = 0;
+            minFree_ = r - 8;
+            return data_;
+        }
+        minFree_ = 0;
+        return nullptr;
+    }
+    minFree_ = r - w - 8;
+    return minFree_ >= n ? data_ + w : nullptr;
+}
+
+BinaryLogging::StagingBuffer* BinaryLogging::createStagingBuffer() {
+    BinaryLogState& s = state();
+    if(t_retired) {
+        // 线程退出过程中(例如其他thread_local对象析构时)又写日志，丢弃并计数
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.retiredDropped++;
+        return nullptr;
+    }
+    StagingBuffer* buffer = new StagingBuffer(CurrentThread::tid());
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.buffers.push_back(buffer);
+    }
+    t_stagingBuffer = buffer;
+    t_retirer.buffer = buffer;
+    return buffer;
+}
+
+void BinaryLogging::retire(StagingBuffer* buffer) {
+    t_stagingBuffer = nullptr;
+    t_retired = true;
+    BinaryLogState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if(s.threadActive) {
+        buffer->retired_.store(true, std::memory_order_release);
+        return;
+    }
+    // 没有后台线程(start之前或者stop之后)，不会再有人读这个缓冲区，直接释放
+    s.buffers.erase(std::find(s.buffers.begin(), s.buffers.end(), buffer));
+    s.retiredDropped += buffer->dropped_.load(std::memory_order_relaxed);
+    delete buffer;
+}
+
+uint32_t BinaryLogging::registerSite(LogLevel level, const char* file, int line, const char* fmt,
+                                     const uint8_t* types, size_t numArgs) {
+    BinaryLogState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    Site site;
+    site.level = level;
+    site.file = file;
+    site.line = line;
+    site.fmt = fmt;
+    site.types = types;
+    site.numArgs = numArgs;
+    s.sites.push_back(site);
+    return static_cast<uint32_t>(s.sites.size() - 1);
+}
+
+uint64_t BinaryLogging::droppedMessages() {
+    BinaryLogState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    uint64_t dropped = s.retiredDropped;
+    for(StagingBuffer* buffer : s.buffers) {
+        dropped += buffer->dropped_.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+// 把一个缓冲区中已提交的记录全部写入文件，返回写入的字节数
+size_t BinaryLogging::drain(StagingBuffer* buffer, size_t committed) {
+    BinaryLogState& s = state();
+    size_t r = buffer->readPos_.load(std::memory_order_relaxed);
+    if(r == committed) {
+        return 0;
+    }
+
+    // 已提交的数据最多分成两段连续内存(绕回前后)，每段整体写入
+    size_t bytes = 0;
+    while(r != committed) {
+        size_t start = r;
+        while(r != committed && r < kStagingBufferSize) {
+            const RecordHeader* header = reinterpret_cast<const RecordHeader*>(buffer->data_ + r);
+            if(header->siteId == kWrapMarker) {
+                break;
+            }
+            r += header->size;
+        }
+        if(r > start) {
+            writeKind(s.fp, blogfile::kRecords);
+            writeU32(s.fp, static_cast<uint32_t>(buffer->tid_));
+            writeU32(s.fp, static_cast<uint32_t>(r - start));
+            writeBytes(s.fp, buffer->data_ + start, r - start);
+            bytes += r - start;
+        }
+        if(r != committed) {
+            r = 0;  // 到达结尾或者绕回标记
+        }
+    }
+    buffer->readPos_.store(r, std::memory_order_release);
+    return bytes;
+}
+
+void BinaryLogging::threadFunc() {
+    BinaryLogState& s = state();
+    auto lastFlush = std::chrono::steady_clock::now();
+    bool more = true;
+    // 停止时再多读一轮，保证stop之前提交的记录都写入文件
+    while(s.running.load(std::memory_order_acquire) || more) {
+        more = s.running.load(std::memory_order_acquire);
+
+        std::vector<StagingBuffer*> buffers;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            buffers = s.buffers;
+        }
+        // 先读取各缓冲区的提交位置，再写调用点定义，这样这些记录用到的调用点一定已经写入
+        std::vector<size_t> committed(buffers.size());
+        std::vector<bool> retired(buffers.size());
+        for(size_t i = 0; i < buffers.size(); i++) {
+            retired[i] = buffers[i]->retired_.load(std::memory_order_acquire);
+            committed[i] = buffers[i]->committed_.load(std::memory_order_acquire);
+        }
+        writeNewSites(s);
+
+        size_t bytes = 0;
+        for(size_t i = 0; i < buffers.size(); i++) {
+            bytes += drain(buffers[i], committed[i]);
+        }
+
+        uint64_t dropped = 0;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            dropped = s.retiredDropped;
+        }
+        for(StagingBuffer* buffer : buffers) {
+            dropped += buffer->dropped_.load(std::memory_order_relaxed);
+        }
+        if(dropped > s.dropped) {
+            writeKind(s.fp, blogfile::kDropped);
+            uint64_t n = dropped - s.dropped;
+            writeBytes(s.fp, &n, sizeof(n));
+            s.dropped = dropped;
+        }
+
+        // 退休的缓冲区读空后释放，它的丢弃计数转入retiredDropped
+        for(size_t i = 0; i < buffers.size(); i++) {
+            if(retired[i] && buffers[i]->readPos_.load(std::memory_order_relaxed) == committed[i]) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.buffers.erase(std::find(s.buffers.begin(), s.buffers.end(), buffers[i]));
+                s.retiredDropped += buffers[i]->dropped_.load(std::memory_order_relaxed);
+                delete buffers[i];
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if(now - lastFlush > std::chrono::seconds(1)) {
+            ::fflush(s.fp);
+            lastFlush = now;
+        }
+        if(bytes == 0 && s.running.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    ::fflush(s.fp);
+}
+
+bool BinaryLogging::start(const std::string& filename) {
+    BinaryLogState& s = state();
+    if(s.running) {
+        return false;
+    }
+    s.fp = ::fopen(filename.c_str(), "we");
+    if(s.fp == nullptr) {
+        LOG_ERROR("BinaryLogging::start open %s failed: %d\n", filename.c_str(), errno);
+        return false;
+    }
+
+    // 校准时间戳：记录一对(时间戳, 墙上时间)，再隔10ms测量时间戳的频率
+    blogfile::FileHeader header;
+    memcpy(header.magic, blogfile::kMagic, sizeof(header.magic));
+    header.anchorTimestamp = rdtsc();
+    header.anchorRealtimeNs = realtimeNs();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    uint64_t ts = rdtsc();
+    int64_t ns = realtimeNs();
+    header.ticksPerNs = ns > header.anchorRealtimeNs
+                        ? static_cast<double>(ts - header.anchorTimestamp) / (ns - header.anchorRealtimeNs)
+                        : 1.0;
+    writeBytes(s.fp, &header, sizeof(header));
+
+    s.writtenSites = 0;
+    s.dropped = 0;
+    s.running = true;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.threadActive = true;
+    }
+    s.thread = std::thread(&BinaryLogging::threadFunc);
+    return true;
+}
+
+void BinaryLogging::stop() {
+    BinaryLogState& s = state();
+    if(!s.running) {
+        return;
+    }
+    s.running = false;
+    s.thread.join();
+    ::fclose(s.fp);
+    s.fp = nullptr;
+
+    // 后台线程最后一轮已经把退休的缓冲区读空，之后提交的记录不会再写出，这里释放掉
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.threadActive = false;
+    for(auto it = s.buffers.begin(); it != s.buffers.end(); ) {
+        StagingBuffer* buffer = *it;
+        if(buffer->retired_.load(std::memory_order_acquire)) {
+            s.retiredDropped += buffer->dropped_.load(std::memory_order_relaxed);
+            delete buffer;
+            it = s.buffers.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
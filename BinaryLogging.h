@@ -0,0 +1,260 @@
+#ifndef __BINARYLOGGING_H__
+#define __BINARYLOGGING_H__
+
+#include "noncopyable.h"
+#include "Logger.h"
+
+#include <string>
+#include <atomic>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+/*
+ 二进制日志，格式化推迟到离线解码(NanoLog的思路)
+ 每个调用点第一次执行时把格式串、文件、行号和参数类型注册一次，得到一个siteId
+ 之后热路径只把siteId、时间戳(rdtsc)和原始参数拷贝进本线程的环形缓冲区，不做任何格式化
+ 后台线程轮询所有线程的缓冲区，把记录原样写入二进制文件，用tools/BinaryLogDecoder还原成文本
+
+ 用法：
+   BinaryLogging::start("/var/log/server.blog");
+   BLOG_INFO("conn %s read %d bytes", conn->name().c_str(), n);
+   BinaryLogging::stop();
+
+ 限制：格式串必须是字面量，不支持宽度/精度为*的转换说明；缓冲区满时丢弃并计数
+*/
+
+// 参数类型，注册时写入文件供解码器使用
+enum BinaryLogArgType : uint8_t {
+    kBlogInt = 1,       // 有符号整数，按int64保存
+    kBlogUInt,          // 无符号整数，按uint64保存
+    kBlogDouble,
+    kBlogString,        // uint32长度 + 字符串内容
+    kBlogPointer,
+};
+
+class BinaryLogging : noncopyable {
+public:
+    // 每条记录的头部，后面紧跟参数，整条记录按8字节对齐
+    struct RecordHeader {
+        uint32_t siteId;
+        uint32_t size;          // 包括头部和对齐填充
+        uint64_t timestamp;     // rdtsc
+    };
+
+    static const uint32_t kWrapMarker = 0xffffffffu;
+    static const size_t kStagingBufferSize = 1024*1024;  // 每个线程的环形缓冲区大小
+
+    // 单生产者(日志线程)单消费者(后台线程)的环形缓冲区
+    class StagingBuffer : noncopyable {
+    public:
+        explicit StagingBuffer(pid_t tid);
+        ~StagingBuffer();
+
+        // 预留n字节的连续空间，空间不足返回nullptr
+        char* reserve(size_t n) {
+            if(n <= minFree_) {
+                return data_ + writePos_;
+            }
+            return reserveSlow(n);
+        }
+        void commit(size_t n) {
+            writePos_ += n;
+            minFree_ -= n;
+            committed_.store(writePos_, std::memory_order_release);
+        }
+        void drop() { dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    private:
+        friend class BinaryLogging;
+        char* reserveSlow(size_t n);
+
+        // 生产者
+        size_t writePos_;
+        size_t minFree_;            // 从writePos_开始确定可写的连续字节数，不够时才去读readPos_
+        std::atomic<size_t> committed_;
+        std::atomic<uint64_t> dropped_;
+        char pad_[64];
+        // 消费者
+        std::atomic<size_t> readPos_;
+        std::atomic<bool> retired_; // 线程已经退出，读空后由后台线程释放
+        const pid_t tid_;
+        char* data_;
+    };
+
+    // 打开日志文件并启动后台线程
+    static bool start(const std::string& filename);
+    // 写完剩余记录，关闭文件
+    static void stop();
+    static uint64_t droppedMessages();
+    // 线程退出时调用，之后由后台线程读空并释放它的缓冲区；后台线程没有运行时直接释放，未写出的记录丢弃
+    // 之后本线程(例如其他thread_local对象的析构函数中)的日志不再创建缓冲区，计入丢弃条数
+    static void retire(StagingBuffer* buffer);
+
+    template<typename... Args>
+    static uint32_t registerSite(LogLevel level, const char* file, int line, const char* fmt, const Args&...) {
+        static const uint8_t types[] = { argType<Args>()..., 0 };
+        return registerSite(level, file, line, fmt, types, sizeof...(Args));
+    }
+
+    template<typename... Args>
+    static void log(uint32_t siteId, const Args&... args) {
+        size_t size = (sizeof(RecordHeader) + payloadSize(args...) + 7) & ~static_cast<size_t>(7);
+        StagingBuffer* buffer = t_stagingBuffer;
+        if(buffer == nullptr) {
+            buffer = createStagingBuffer();
+            if(buffer == nullptr) {
+                return;     // 线程正在退出，缓冲区已经退休，已经计入丢弃条数
+            }
+        }
+        char* p = buffer->reserve(size);
+        if(p == nullptr) {
+            buffer->drop();
+            return;
+        }
+        RecordHeader* header = reinterpret_cast<RecordHeader*>(p);
+        header->siteId = siteId;
+        header->size = static_cast<uint32_t>(size);
+        header->timestamp = rdtsc();
+        encode(p + sizeof(RecordHeader), args...);
+        buffer->commit(size);
+    }
+
+    // 时间戳，解码时根据文件头中的校准信息换算成墙上时间
+    static uint64_t rdtsc() {
+#if defined(__x86_64__) || defined(__i386__)
+        uint32_t lo, hi;
+        __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+        return (static_cast<uint64_t>(hi) << 32) | lo;
+#else
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+    }
+
+    // 只用于让编译器检查格式串与参数是否匹配，不会被调用
+    static void checkFormat(const char*, ...) __attribute__((format(printf, 1, 2))) {}
+
+private:
+    static uint32_t registerSite(LogLevel level, const char* file, int line, const char* fmt,
+                                 const uint8_t* types, size_t numArgs);
+    // 本线程的缓冲区已经退休时返回nullptr
+    static StagingBuffer* createStagingBuffer();
+    static size_t drain(StagingBuffer* buffer, size_t committed);
+    static void threadFunc();
+
+    static __thread StagingBuffer* t_stagingBuffer __attribute__((tls_model("initial-exec")));
+    static const char* nullString() { return "(null)"; }
+
+    // 参数类型
+    template<typename T>
+    static constexpr uint8_t argType() {
+        return std::is_floating_point<T>::value ? kBlogDouble
+             : (std::is_integral<T>::value || std::is_enum<T>::value)
+                ? (std::is_signed<T>::value || std::is_enum<T>::value ? kBlogInt : kBlogUInt)
+             : std::is_same<typename std::decay<T>::type, const char*>::value ? kBlogString
+             : std::is_same<typename std::decay<T>::type, char*>::value ? kBlogString
+             : kBlogPointer;
+    }
+
+    // 参数编码后的大小
+    static size_t payloadSize() { return 0; }
+    template<typename T, typename... Args>
+    static size_t payloadSize(const T& arg, const Args&... args) {
+        return argSize(arg) + payloadSize(args...);
+    }
+    template<typename T>
+    static size_t argSize(const T&) { return 8; }
+    static size_t argSize(const char* s) { return sizeof(uint32_t) + strlen(s != nullptr ? s : nullString()); }
+    static size_t argSize(char* s) { return argSize(static_cast<const char*>(s)); }
+
+    // 参数编码
+    static void encode(char*) {}
+    template<typename T, typename... Args>
+    static void encode(char* p, const T& arg, const Args&... args) {
+        encode(encodeArg(p, arg), args...);
+    }
+    template<typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, char*>::type encodeArg(char* p, const T& v) {
+        double d = v;
+        memcpy(p, &d, 8);
+        return p + 8;
+    }
+    template<typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, char*>::type encodeArg(char* p, const T& v) {
+        int64_t i = static_cast<int64_t>(v);
+        memcpy(p, &i, 8);
+        return p + 8;
+    }
+    template<typename T>
+    static typename std::enable_if<std::is_pointer<T>::value, char*>::type encodeArg(char* p, const T& v) {
+        uint64_t ptr = reinterpret_cast<uintptr_t>(v);
+        memcpy(p, &ptr, 8);
+        return p + 8;
+    }
+    // 与printf的常见实现一致，空指针输出(null)
+    static char* encodeArg(char* p, const char* s) {
+        if(s == nullptr) {
+            s = nullString();
+        }
+        uint32_t len = static_cast<uint32_t>(strlen(s));
+        memcpy(p, &len, sizeof(len));
+        memcpy(p + sizeof(len), s, len);
+        return p + sizeof(len) + len;
+    }
+    static char* encodeArg(char* p, char* s) { return encodeArg(p, static_cast<const char*>(s)); }
+};
+
+// 二进制日志文件格式，解码器共用
+namespace blogfile {
+    const char kMagic[8] = { 'M', 'U', 'D', 'U', 'O', 'B', 'L', '1' };
+    // 文件头：magic，校准用的时间戳与墙上时间(ns)，每纳秒的时间戳计数
+    struct FileHeader {
+        char magic[8];
+        uint64_t anchorTimestamp;
+        int64_t anchorRealtimeNs;
+        double ticksPerNs;
+    };
+    // 文件头之后是一串条目，每个条目以一个字节的类型开始
+    enum EntryKind : uint8_t {
+        kSiteDef = 1,   // uint32 id, uint32 level, uint32 line, uint32 numArgs, types[numArgs],
+                        // uint32 fileLen, file, uint32 fmtLen, fmt
+        kRecords,       // uint32 tid, uint32 len, len字节的连续记录(RecordHeader + 参数)
+        kDropped,       // uint64 丢弃的条数
+    };
+}
+
+#define MUDUO_BLOG_IMPL(level, logmsgFormat, ...) \
+    do { \
+        if(false) { \
+            BinaryLogging::checkFormat(logmsgFormat, ##__VA_ARGS__); \
+        } \
+        if(Logger::logLevel() <= level) { \
+            static const uint32_t blogSiteId = \
+                BinaryLogging::registerSite(level, __FILE__, __LINE__, logmsgFormat, ##__VA_ARGS__); \
+            BinaryLogging::log(blogSiteId, ##__VA_ARGS__); \
+        } \
+    }while(0)
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_DEBUG
+#define BLOG_DEBUG(logmsgFormat, ...) MUDUO_BLOG_IMPL(DEBUG, logmsgFormat, ##__VA_ARGS__)
+#else
+#define BLOG_DEBUG(logmsgFormat, ...) do {}while(0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_INFO
+#define BLOG_INFO(logmsgFormat, ...) MUDUO_BLOG_IMPL(INFO, logmsgFormat, ##__VA_ARGS__)
+#else
+#define BLOG_INFO(logmsgFormat, ...) do {}while(0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_ERROR
+#define BLOG_ERROR(logmsgFormat, ...) MUDUO_BLOG_IMPL(ERROR, logmsgFormat, ##__VA_ARGS__)
+#else
+#define BLOG_ERROR(logmsgFormat, ...) do {}while(0)
+#endif
+
+#endif
@@ -1,14 +1,158 @@
 #include "Buffer.h"
+#include "BufferPool.h"
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <utility>
 #include <sys/uio.h>
 #include <unistd.h>
 
+Buffer::Buffer(size_t initialSize)
+    : data_(static_cast<char*>(::malloc(kCheapPrepend + initialSize)))
+    , capacity_(kCheapPrepend + initialSize)
+    , readerIndex_(kCheapPrepend)
+    , writerIndex_(kCheapPrepend)
+    , readHint_(0)
+    , pool_(nullptr)
+{
+    if(data_ == nullptr) {
+        throw std::bad_alloc();
+    }
+}
+
+Buffer::Buffer(BufferPool* pool)
+    : data_(nullptr)
+    , capacity_(0)
+    , readerIndex_(0)
+    , writerIndex_(0)
+    , readHint_(0)
+    , pool_(pool)
+{}
+
+Buffer::~Buffer() {
+    releaseStorage();
+}
+
+Buffer::Buffer(const Buffer& rhs)
+    : data_(nullptr)
+    , capacity_(0)
+    , readerIndex_(0)
+    , writerIndex_(0)
+    , readHint_(rhs.readHint_)
+    , pool_(nullptr)
+{
+    append(rhs.peek(), rhs.readableBytes());
+}
+
+Buffer& Buffer::operator=(const Buffer& rhs) {
+    if(this != &rhs) {
+        Buffer tmp(rhs);
+        swap(tmp);
+    }
+    return *this;
+}
+
+Buffer::Buffer(Buffer&& rhs)
+    : data_(rhs.data_)
+    , capacity_(rhs.capacity_)
+    , readerIndex_(rhs.readerIndex_)
+    , writerIndex_(rhs.writerIndex_)
+    , readHint_(rhs.readHint_)
+    , pool_(rhs.pool_)
+{
+    rhs.data_ = nullptr;
+    rhs.capacity_ = 0;
+    rhs.readerIndex_ = 0;
+    rhs.writerIndex_ = 0;
+}
+
+Buffer& Buffer::operator=(Buffer&& rhs) {
+    if(this != &rhs) {
+        Buffer tmp(std::move(rhs));
+        swap(tmp);
+    }
+    return *this;
+}
+
+void Buffer::swap(Buffer& rhs) {
+    std::swap(data_, rhs.data_);
+    std::swap(capacity_, rhs.capacity_);
+    std::swap(readerIndex_, rhs.readerIndex_);
+    std::swap(writerIndex_, rhs.writerIndex_);
+    std::swap(readHint_, rhs.readHint_);
+    std::swap(pool_, rhs.pool_);
+}
+
+void Buffer::makePrependSpace(size_t len) {
+    if(data_ == nullptr || writableBytes() + prependableBytes() < len) {
+        grow(len);  // 可读数据移到kCheapPrepend处，后面至少空出len字节
+        if(prependableBytes() >= len) {
+            return;
+        }
+    }
+    // 可读数据整体后移，前面正好空出len字节
+    size_t readable = readableBytes();
+    memmove(begin() + len, begin() + readerIndex_, readable);
+    readerIndex_ = len;
+    writerIndex_ = len + readable;
+}
+
+void Buffer::grow(size_t len) {
+    size_t readable = readableBytes();
+    // 按倍数增长，避免逐次追加时反复拷贝；池中的块本身就是2的幂，超过最大级别后也要靠这里翻倍
+    size_t capacity = std::max(kCheapPrepend + readable + len, capacity_ * 2);
+    char* data;
+    if(pool_ != nullptr) {
+        data = pool_->allocate(capacity, &capacity);
+    }
+    else {
+        data = static_cast<char*>(::malloc(capacity));
+        if(data == nullptr) {
+            throw std::bad_alloc();
+        }
+    }
+    if(readable > 0) {
+        memcpy(data + kCheapPrepend, peek(), readable);
+    }
+    size_t hint = readHint_;
+    releaseStorage();
+    data_ = data;
+    capacity_ = capacity;
+    readerIndex_ = kCheapPrepend;
+    writerIndex_ = kCheapPrepend + readable;
+    readHint_ = hint;
+}
+
+void Buffer::releaseStorage() {
+    if(data_ != nullptr) {
+        if(pool_ != nullptr) {
+            pool_->deallocate(data_, capacity_);
+        }
+        else {
+            ::free(data_);
+        }
+    }
+    data_ = nullptr;
+    capacity_ = 0;
+    readerIndex_ = 0;
+    writerIndex_ = 0;
+}
+
 /**
  * 从fd里读数据 Poller工作于水平触发LT模式，数据不读完一直通知
  * Buffer缓冲区有大小，从fd上读数据不知道TCP最终大小
  */
 ssize_t Buffer::readFd(int fd, int* saveErrno) {
-    char extrabuf[65536] = {0}; // 64k
+    char extrabuf[65536];   // 64k，只是暂存，不需要清零
+    return readFd(fd, saveErrno, extrabuf, sizeof(extrabuf));
+}
+
+ssize_t Buffer::readFd(int fd, int* saveErrno, char* staging, size_t stagingLen) {
+    // 先按预估的读取量准备好可写空间，让数据尽量直接读进buffer_
+    if(writableBytes() < readHint_) {
+        ensureriteableBytes(readHint_);
+    }
 
     iovec vec[2];
 
@@ -16,24 +160,64 @@ ssize_t Buffer::readFd(int fd, int* saveErrno) {
     vec[0].iov_base = beginWrite();
     vec[0].iov_len = writable;
 
-    vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof(extrabuf);  // sizeof在编译器就告诉大小
+    vec[1].iov_base = staging;
+    vec[1].iov_len = stagingLen;
 
-    const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;   // 不够64k，选择2
+    const int iovcnt = (writable < stagingLen) ? 2 : 1;     // 可写空间不够暂存区大小，选择2
     const ssize_t n = ::readv(fd, vec, iovcnt);
     if(n < 0) {
         *saveErrno = errno;
     }
-    else if(n <= writable) {
+    else if(static_cast<size_t>(n) <= writable) {
         writerIndex_ += n;
     }
-    else {  // extrabuf中也写入了数据
-        writerIndex_ = buffer_.size();
-        append(extrabuf, n - writable);
+    else {  // 暂存区中也写入了数据
+        writerIndex_ = capacity_;
+        append(staging, n - writable);
+    }
+
+    // 读取量超过预估时立即跟上，变小时缓慢回落，避免反复扩容
+    if(n > 0) {
+        size_t len = static_cast<size_t>(n);
+        if(len >= readHint_) {
+            readHint_ = len < kMaxReadHint ? len : kMaxReadHint;
+        }
+        else {
+            readHint_ -= (readHint_ - len) / 8;
+        }
     }
     return n;
 }
 
+ssize_t Buffer::readFdUntilAgain(int fd, size_t maxBytes, int* saveErrno, bool* eof,
+                                 char* staging, size_t stagingLen) {
+    size_t total = 0;
+    *saveErrno = 0;
+    *eof = false;
+    while(total < maxBytes) {
+        int err = 0;
+        ssize_t n = readFd(fd, &err, staging, stagingLen);
+        if(n > 0) {
+            total += n;
+        }
+        else if(n == 0) {
+            *eof = true;
+            break;
+        }
+        else {
+            if(err == EINTR) {
+                continue;
+            }
+            *saveErrno = err;
+            if(total == 0) {
+                return -1;
+            }
+            break;
+        }
+    }
+    return static_cast<ssize_t>(total);
+}
+
 ssize_t Buffer::writeFd(int fd, int* saveErrno) {
     ssize_t n = ::write(fd, peek(), readableBytes());
     if(n < 0) {
@@ -1,28 +1,42 @@
 #ifndef __BUFFER_H__
 #define __BUFFER_H__
 
-#include <vector>
 #include <string>
 #include <algorithm>
+#include <assert.h>
+#include <endian.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+class BufferPool;
 
 // 网络库底层缓冲区定义
+// 存储空间不做初始化；使用BufferPool时按需从池中分配，retrieveAll后归还，空闲的连接不占用缓冲区内存
 class Buffer {
 public:
     static const size_t kCheapPrepend = 8;
     static const size_t kInitialSize = 1024;
+    static const size_t kMaxReadHint = 64*1024;    // 预估读取量的上限，与暂存区大小一致
+
+    explicit Buffer(size_t initialSize = kInitialSize);
+    // 存储空间从pool中分配，第一次写入时才分配
+    explicit Buffer(BufferPool* pool);
+    ~Buffer();
 
-    explicit Buffer(size_t initialSize = kInitialSize)
-        : buffer_(kCheapPrepend + initialSize) 
-        , readerIndex_(kCheapPrepend)
-        , writerIndex_(kCheapPrepend)
-    {}
+    // 拷贝出来的Buffer不属于任何池
+    Buffer(const Buffer& rhs);
+    Buffer& operator=(const Buffer& rhs);
+    Buffer(Buffer&& rhs);
+    Buffer& operator=(Buffer&& rhs);
+    void swap(Buffer& rhs);
     
     size_t readableBytes() const {
         return writerIndex_ - readerIndex_;
     }
 
     size_t writableBytes() const {
-        return buffer_.size() - writerIndex_;
+        return capacity_ - writerIndex_;
     }
 
     size_t prependableBytes() const {
@@ -44,10 +58,15 @@ public:
         }
     }
 
-    //  所有数据都已经读完，将可读区域覆盖
+    //  所有数据都已经读完，将可读区域覆盖；使用池时把存储空间还给池
     void retrieveAll() {
-        readerIndex_ = kCheapPrepend;
-        writerIndex_ = kCheapPrepend;
+        if(pool_ != nullptr) {
+            releaseStorage();
+        }
+        else {
+            readerIndex_ = data_ != nullptr ? kCheapPrepend : 0;
+            writerIndex_ = readerIndex_;
+        }
     }
 
     // 把onMessage函数上报的Buffer数据转换为string
@@ -75,6 +94,111 @@ public:
         writerIndex_ += len;
     }
 
+    void append(const void* data, size_t len) {
+        append(static_cast<const char*>(data), len);
+    }
+
+    // 以网络字节序(大端)追加整数
+    void appendInt64(int64_t x) {
+        int64_t be64 = htobe64(x);
+        append(&be64, sizeof(be64));
+    }
+
+    void appendInt32(int32_t x) {
+        int32_t be32 = htobe32(x);
+        append(&be32, sizeof(be32));
+    }
+
+    void appendInt16(int16_t x) {
+        int16_t be16 = htobe16(x);
+        append(&be16, sizeof(be16));
+    }
+
+    void appendInt8(int8_t x) {
+        append(&x, sizeof(x));
+    }
+
+    // 按网络字节序读出开头的整数，不移动读指针；调用前需要保证readableBytes()足够
+    int64_t peekInt64() const {
+        assert(readableBytes() >= sizeof(int64_t));
+        int64_t be64;
+        memcpy(&be64, peek(), sizeof(be64));
+        return be64toh(be64);
+    }
+
+    int32_t peekInt32() const {
+        assert(readableBytes() >= sizeof(int32_t));
+        int32_t be32;
+        memcpy(&be32, peek(), sizeof(be32));
+        return be32toh(be32);
+    }
+
+    int16_t peekInt16() const {
+        assert(readableBytes() >= sizeof(int16_t));
+        int16_t be16;
+        memcpy(&be16, peek(), sizeof(be16));
+        return be16toh(be16);
+    }
+
+    int8_t peekInt8() const {
+        assert(readableBytes() >= sizeof(int8_t));
+        return *peek();
+    }
+
+    // 读出开头的整数并移动读指针
+    int64_t readInt64() {
+        int64_t result = peekInt64();
+        retrieve(sizeof(result));
+        return result;
+    }
+
+    int32_t readInt32() {
+        int32_t result = peekInt32();
+        retrieve(sizeof(result));
+        return result;
+    }
+
+    int16_t readInt16() {
+        int16_t result = peekInt16();
+        retrieve(sizeof(result));
+        return result;
+    }
+
+    int8_t readInt8() {
+        int8_t result = peekInt8();
+        retrieve(sizeof(result));
+        return result;
+    }
+
+    // 把数据写到可读数据前面，通常使用预留的kCheapPrepend区域，不搬移已有数据
+    // 用于在序列化完消息体之后补上长度头；前面空间不够时把可读数据后移，必要时扩容
+    void prepend(const void* data, size_t len) {
+        if(data_ == nullptr || len > prependableBytes()) {
+            makePrependSpace(len);
+        }
+        readerIndex_ -= len;
+        memcpy(begin() + readerIndex_, data, len);
+    }
+
+    void prependInt64(int64_t x) {
+        int64_t be64 = htobe64(x);
+        prepend(&be64, sizeof(be64));
+    }
+
+    void prependInt32(int32_t x) {
+        int32_t be32 = htobe32(x);
+        prepend(&be32, sizeof(be32));
+    }
+
+    void prependInt16(int16_t x) {
+        int16_t be16 = htobe16(x);
+        prepend(&be16, sizeof(be16));
+    }
+
+    void prependInt8(int8_t x) {
+        prepend(&x, sizeof(x));
+    }
+
     // 返回可写区域
     char* beginWrite() {
         return begin() + writerIndex_;
@@ -85,25 +209,33 @@ public:
         return begin() + writerIndex_;
     }
 
-    // 从fd里读数据
+    // 从fd里读数据，放不下的部分先读到栈上的暂存区
     ssize_t readFd(int fd, int* saveErrno);
+    // 同上，使用调用者提供的暂存区(EventLoop::readStagingBuffer)，暂存区不需要初始化
+    // 读之前按照最近几次的读取量预先扩充可写空间，通常数据直接读进buffer_，不经过暂存区二次拷贝
+    ssize_t readFd(int fd, int* saveErrno, char* staging, size_t stagingLen);
+    // 边沿触发模式使用，循环读取直到EAGAIN、对端关闭、出错或者累计读够maxBytes
+    // 返回读到的总字节数，一个字节都没读到时与readFd相同返回0或-1(包括EAGAIN)
+    // *saveErrno在读到EAGAIN时为EAGAIN，因为maxBytes停止时为0，*eof表示是否读到了对端关闭
+    ssize_t readFdUntilAgain(int fd, size_t maxBytes, int* saveErrno, bool* eof,
+                             char* staging, size_t stagingLen);
 
     // 向fd写数据
     ssize_t writeFd(int fd, int* saveErrno);
 
 private:
     char* begin() {
-        return &*buffer_.begin();
+        return data_;
     }
 
     const char* begin() const {
-        return &*buffer_.begin();
+        return data_;
     }
 
     void makeSpace(size_t len) {
         if(writableBytes() + prependableBytes() < len + kCheapPrepend) {
-            // 已经读取完的缓冲区加目前可以写入的缓冲区不满足写入要求，buffer_需要扩容
-            buffer_.resize(writerIndex_ + len);
+            // 已经读取完的缓冲区加目前可以写入的缓冲区不满足写入要求，需要换一块更大的存储空间
+            grow(len);
         }
         else {
             size_t readable = readableBytes();
@@ -113,9 +245,20 @@ private:
         }
     }
 
-    std::vector<char> buffer_;
+    // 让可读数据前面至少有len字节，存储空间已经还给池时重新分配
+    void makePrependSpace(size_t len);
+    // 换一块至少能再写入len字节的存储空间，可读数据移到kCheapPrepend处
+    void grow(size_t len);
+    // 释放存储空间，之后data_为空，各个下标为0
+    void releaseStorage();
+
+    // 没有存储空间时data_为空、capacity_和下标都为0，可读可写字节数都是0
+    char* data_;
+    size_t capacity_;
     size_t readerIndex_;
     size_t writerIndex_;
+    size_t readHint_;   // 根据最近的读取量预估的下一次读取量
+    BufferPool* pool_;
 };
 
 #endif
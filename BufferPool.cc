@@ -0,0 +1,177 @@
+#include "BufferPool.h"
+#include "CurrentThread.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <new>
+#include <sys/mman.h>
+
+BufferPool::BufferPool(bool useHugePages)
+    : ownerThread_(CurrentThread::tid())
+    , useHugePages_(useHugePages)
+    , hugePagesActive_(false)
+    , slabCur_(nullptr)
+    , slabEnd_(nullptr)
+    , slabBytes_(0)
+    , largeBytes_(0)
+    , numRemoteFrees_(0)
+{}
+
+BufferPool::~BufferPool() {
+    for(char* slab : slabs_) {
+        ::munmap(slab, kSlabSize);
+    }
+}
+
+// 向上取整到2的幂对应的级别，超过最大级别返回-1
+int BufferPool::classIndex(size_t size) {
+    size_t shift = kMinChunkShift;
+    while((static_cast<size_t>(1) << shift) < size) {
+        if(++shift > kMaxChunkShift) {
+            return -1;
+        }
+    }
+    return static_cast<int>(shift - kMinChunkShift);
+}
+
+char* BufferPool::allocate(size_t size, size_t* capacity) {
+    int index = classIndex(size);
+    if(index < 0) {
+        // 大块不进池
+        char* p = static_cast<char*>(::malloc(size));
+        if(p == nullptr) {
+            throw std::bad_alloc();
+        }
+        largeBytes_.fetch_add(size, std::memory_order_relaxed);
+        *capacity = size;
+        return p;
+    }
+
+    if(numRemoteFrees_.load(std::memory_order_acquire) > 0) {
+        drainRemoteFrees();
+    }
+
+    size_t chunkSize = static_cast<size_t>(1) << (index + kMinChunkShift);
+    SizeClass& sc = classes_[index];
+    char* p;
+    if(sc.freeList != nullptr) {
+        p = reinterpret_cast<char*>(sc.freeList);
+        sc.freeList = sc.freeList->next;
+        sc.free.fetch_sub(1, std::memory_order_relaxed);
+    }
+    else {
+        p = allocateFromSlab(chunkSize);
+    }
+    sc.inUse.fetch_add(1, std::memory_order_relaxed);
+    *capacity = chunkSize;
+    return p;
+}
+
+void BufferPool::deallocate(char* p, size_t capacity) {
+    if(classIndex(capacity) < 0) {
+        ::free(p);
+        largeBytes_.fetch_sub(capacity, std::memory_order_relaxed);
+        return;
+    }
+    if(CurrentThread::tid() == ownerThread_) {
+        classes_[classIndex(capacity)].inUse.fetch_sub(1, std::memory_order_relaxed);
+        pushFree(p, capacity);
+    }
+    else {
+        // 在这里就算作不再使用，统计里的inUse才能反映真实占用
+        classes_[classIndex(capacity)].inUse.fetch_sub(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(remoteMutex_);
+        remoteFrees_.push_back(std::make_pair(p, capacity));
+        numRemoteFrees_.store(remoteFrees_.size(), std::memory_order_release);
+    }
+}
+
+void BufferPool::pushFree(char* p, size_t capacity) {
+    SizeClass& sc = classes_[classIndex(capacity)];
+    FreeChunk* chunk = reinterpret_cast<FreeChunk*>(p);
+    chunk->next = sc.freeList;
+    sc.freeList = chunk;
+    sc.free.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BufferPool::drainRemoteFrees() {
+    std::vector<std::pair<char*, size_t>> frees;
+    {
+        std::lock_guard<std::mutex> lock(remoteMutex_);
+        frees.swap(remoteFrees_);
+        numRemoteFrees_.store(0, std::memory_order_relaxed);
+    }
+    for(const auto& item : frees) {
+        pushFree(item.first, item.second);
+    }
+}
+
+char* BufferPool::allocateFromSlab(size_t chunkSize) {
+    if(static_cast<size_t>(slabEnd_ - slabCur_) < chunkSize) {
+        // 当前slab剩余部分按从大到小切分给各级别的空闲链表，然后申请新的slab
+        for(int i = kNumClasses - 1; i >= 0 && slabCur_ != slabEnd_; i--) {
+            size_t size = static_cast<size_t>(1) << (i + kMinChunkShift);
+            while(static_cast<size_t>(slabEnd_ - slabCur_) >= size) {
+                pushFree(slabCur_, size);
+                slabCur_ += size;
+            }
+        }
+
+        void* slab = MAP_FAILED;
+        if(useHugePages_) {
+            slab = ::mmap(nullptr, kSlabSize, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if(slab != MAP_FAILED) {
+                hugePagesActive_ = true;
+            }
+        }
+        if(slab == MAP_FAILED) {
+            slab = ::mmap(nullptr, kSlabSize, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(slab == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            if(useHugePages_) {
+                // 没有预留大页时退而使用透明大页
+                ::madvise(slab, kSlabSize, MADV_HUGEPAGE);
+            }
+        }
+        slabs_.push_back(static_cast<char*>(slab));
+        slabCur_ = static_cast<char*>(slab);
+        slabEnd_ = slabCur_ + kSlabSize;
+        slabBytes_.fetch_add(kSlabSize, std::memory_order_relaxed);
+    }
+    char* p = slabCur_;
+    slabCur_ += chunkSize;
+    return p;
+}
+
+BufferPool::Snapshot BufferPool::snapshot() const {
+    Snapshot snap;
+    for(int i = 0; i < kNumClasses; i++) {
+        snap.chunkSize[i] = static_cast<size_t>(1) << (i + kMinChunkShift);
+        snap.inUse[i] = classes_[i].inUse.load(std::memory_order_relaxed);
+        snap.free[i] = classes_[i].free.load(std::memory_order_relaxed);
+    }
+    snap.slabBytes = slabBytes_.load(std::memory_order_relaxed);
+    snap.remoteFrees = numRemoteFrees_.load(std::memory_order_relaxed);
+    snap.largeBytes = largeBytes_.load(std::memory_order_relaxed);
+    snap.hugePages = hugePagesActive_.load(std::memory_order_relaxed);
+    return snap;
+}
+
+std::string BufferPool::Snapshot::toString() const {
+    std::string result;
+    char buf[128];
+    snprintf(buf, sizeof(buf), "slab %zuKB large %zuKB remote %zu%s", slabBytes / 1024, largeBytes / 1024,
+             remoteFrees, hugePages ? " hugepages" : "");
+    result += buf;
+    for(int i = 0; i < kNumClasses; i++) {
+        if(inUse[i] == 0 && free[i] == 0) {
+            continue;
+        }
+        snprintf(buf, sizeof(buf), " | %zu: %zu used %zu free", chunkSize[i], inUse[i], free[i]);
+        result += buf;
+    }
+    return result;
+}
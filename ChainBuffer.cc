@@ -0,0 +1,260 @@
+#include "ChainBuffer.h"
+#include "BufferPool.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+// sendfile单次最多传输的字节数
+static const size_t kMaxSendfileBytes = 0x7ffff000;
+
+ChainBuffer::ChainBuffer(BufferPool* pool)
+    : head_(0)
+    , readable_(0)
+    , pool_(pool)
+    , zeroCopyNextId_(0)
+    , zeroCopyDoneId_(0)
+{}
+
+ChainBuffer::~ChainBuffer() {
+    retrieveAll();
+}
+
+void ChainBuffer::append(const char* data, size_t len) {
+    while(len > 0) {
+        if(segments_.size() == head_ || segments_.back().end >= segments_.back().capacity) {
+            // 最后一个片段写满了，或者是外部切片、文件区间(capacity为0)，接一个新块
+            Segment seg;
+            size_t capacity = kBlockSize;
+            if(pool_ != nullptr) {
+                seg.data = pool_->allocate(kBlockSize, &capacity);
+            }
+            else {
+                seg.data = static_cast<char*>(::malloc(kBlockSize));
+                if(seg.data == nullptr) {
+                    throw std::bad_alloc();
+                }
+            }
+            seg.capacity = capacity;
+            seg.begin = 0;
+            seg.end = 0;
+            seg.fd = -1;
+            seg.zeroCopy = false;
+            seg.zeroCopyId = 0;
+            segments_.push_back(std::move(seg));
+        }
+        Segment& tail = segments_.back();
+        size_t n = tail.capacity - tail.end;
+        if(n > len) {
+            n = len;
+        }
+        memcpy(tail.data + tail.end, data, n);
+        tail.end += n;
+        readable_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::appendShared(const std::shared_ptr<const void>& owner, const char* data, size_t len) {
+    if(len < kMinSliceSize) {
+        append(data, len);
+        return;
+    }
+    Segment seg;
+    seg.data = const_cast<char*>(data);
+    seg.capacity = 0;
+    seg.begin = 0;
+    seg.end = len;
+    seg.fd = -1;
+    seg.zeroCopy = false;
+    seg.zeroCopyId = 0;
+    seg.owner = owner;
+    segments_.push_back(std::move(seg));
+    readable_ += len;
+}
+
+void ChainBuffer::appendFile(int fd, off_t offset, size_t len) {
+    if(len == 0) {
+        ::close(fd);
+        return;
+    }
+    Segment seg;
+    seg.data = nullptr;
+    seg.capacity = 0;
+    seg.begin = static_cast<size_t>(offset);
+    seg.end = seg.begin + len;
+    seg.fd = fd;
+    seg.zeroCopy = false;
+    seg.zeroCopyId = 0;
+    segments_.push_back(std::move(seg));
+    readable_ += len;
+}
+
+void ChainBuffer::retrieve(size_t len) {
+    if(len >= readable_) {
+        retrieveAll();
+        return;
+    }
+    readable_ -= len;
+    while(len > 0) {
+        Segment& seg = segments_[head_];
+        size_t n = seg.end - seg.begin;
+        if(len < n) {
+            seg.begin += len;
+            break;
+        }
+        len -= n;
+        releaseSegment(seg);
+        head_++;
+    }
+    // 前面释放掉的片段过多时整体前移，避免segments_只增不减
+    if(head_ > 64 && head_ * 2 > segments_.size()) {
+        segments_.erase(segments_.begin(), segments_.begin() + head_);
+        head_ = 0;
+    }
+}
+
+void ChainBuffer::retrieveAll() {
+    for(size_t i = head_; i < segments_.size(); i++) {
+        releaseSegment(segments_[i]);
+    }
+    segments_.clear();
+    head_ = 0;
+    readable_ = 0;
+}
+
+void ChainBuffer::releaseSegment(Segment& seg) {
+    if(seg.capacity > 0) {
+        if(pool_ != nullptr) {
+            pool_->deallocate(seg.data, seg.capacity);
+        }
+        else {
+            ::free(seg.data);
+        }
+    }
+    else if(seg.fd >= 0) {
+        ::close(seg.fd);
+        seg.fd = -1;
+    }
+    if(seg.zeroCopy && static_cast<int32_t>(seg.zeroCopyId - zeroCopyDoneId_) >= 0) {
+        // 内核可能还在引用这段内存，等完成通知再释放
+        zeroCopyPending_.push_back(std::make_pair(seg.zeroCopyId, std::move(seg.owner)));
+    }
+    seg.zeroCopy = false;
+    seg.data = nullptr;
+    seg.owner.reset();
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int* saveErrno, size_t zeroCopyThreshold) {
+#ifdef MSG_ZEROCOPY
+    if(zeroCopyThreshold > 0 && head_ < segments_.size()) {
+        Segment& seg = segments_[head_];
+        if(seg.owner && seg.end - seg.begin >= zeroCopyThreshold) {
+            ssize_t n = sendZeroCopy(fd, seg, saveErrno);
+            if(n >= 0 || *saveErrno != ENOBUFS) {
+                return n;
+            }
+            // 锁定用户内存超过了optmem限制，这一次退回普通发送
+        }
+    }
+#endif
+
+    if(head_ < segments_.size() && segments_[head_].fd >= 0) {
+        // 前面的内存片段都发完了才轮到文件区间
+        const Segment& seg = segments_[head_];
+        off_t offset = static_cast<off_t>(seg.begin);
+        size_t count = seg.end - seg.begin;
+        if(count > kMaxSendfileBytes) {
+            count = kMaxSendfileBytes;
+        }
+        ssize_t n = ::sendfile(fd, seg.fd, &offset, count);
+        if(n < 0) {
+            *saveErrno = errno;
+        }
+        else if(n == 0) {
+            // 文件被截断了，剩下的区间永远发不出去
+            *saveErrno = ENODATA;
+            n = -1;
+        }
+        return n;
+    }
+
+    struct iovec vec[IOV_MAX];
+    int iovcnt = 0;
+    for(size_t i = head_; i < segments_.size() && iovcnt < IOV_MAX; i++) {
+        const Segment& seg = segments_[i];
+        if(seg.fd >= 0) {
+            break;
+        }
+        if(zeroCopyThreshold > 0 && iovcnt > 0 && seg.owner && seg.end - seg.begin >= zeroCopyThreshold) {
+            // 留给下一次用MSG_ZEROCOPY单独发送
+            break;
+        }
+        vec[iovcnt].iov_base = seg.data + seg.begin;
+        vec[iovcnt].iov_len = seg.end - seg.begin;
+        iovcnt++;
+    }
+    ssize_t n = ::writev(fd, vec, iovcnt);
+    if(n < 0) {
+        *saveErrno = errno;
+    }
+    return n;
+}
+
+ssize_t ChainBuffer::sendZeroCopy(int fd, Segment& seg, int* saveErrno) {
+#ifdef MSG_ZEROCOPY
+    struct iovec vec;
+    vec.iov_base = seg.data + seg.begin;
+    vec.iov_len = seg.end - seg.begin;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &vec;
+    msg.msg_iovlen = 1;
+    ssize_t n = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+    if(n < 0) {
+        *saveErrno = errno;
+    }
+    else {
+        seg.zeroCopy = true;
+        seg.zeroCopyId = zeroCopyNextId_++;
+    }
+    return n;
+#else
+    (void)fd;
+    (void)seg;
+    *saveErrno = ENOBUFS;
+    return -1;
+#endif
+}
+
+std::vector<std::shared_ptr<const void>> ChainBuffer::releaseZeroCopyPending() {
+    retrieveAll();  // 发送过一部分的切片也转入等待队列
+    std::vector<std::shared_ptr<const void>> owners;
+    owners.reserve(zeroCopyPending_.size());
+    for(auto& pending : zeroCopyPending_) {
+        owners.push_back(std::move(pending.second));
+    }
+    zeroCopyPending_.clear();
+    return owners;
+}
+
+void ChainBuffer::zeroCopyCompleted(uint32_t lo, uint32_t hi) {
+    (void)lo;
+    // TCP的完成通知按序号顺序到达，序号会回绕，按差值比较
+    size_t n = 0;
+    while(n < zeroCopyPending_.size() &&
+          static_cast<int32_t>(zeroCopyPending_[n].first - hi) <= 0) {
+        n++;
+    }
+    zeroCopyPending_.erase(zeroCopyPending_.begin(), zeroCopyPending_.begin() + n);
+    if(static_cast<int32_t>(hi + 1 - zeroCopyDoneId_) > 0) {
+        zeroCopyDoneId_ = hi + 1;
+    }
+}
@@ -7,6 +7,7 @@
 const int Channel::kNoneEvent = 0;
 const int Channel::kReadEvent = EPOLLIN | EPOLLPRI;     // EPOLLPRI紧急读事件
 const int Channel::kWriteEvent = EPOLLOUT;
+const int Channel::kEdgeEvents = EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLRDHUP | EPOLLET;
 
 // 每个channel属于一个loop
 Channel::Channel(EventLoop* loop, int fd) 
@@ -15,6 +16,8 @@ Channel::Channel(EventLoop* loop, int fd)
     , events_(0)
     , revents_(0) 
     , index_(-1) 
+    , edgeTriggered_(false)
+    , registeredEvents_(kNoneEvent)
     , tied_(false) {}
 
 Channel::~Channel() {}
@@ -28,6 +31,14 @@ void Channel::tie(const std::shared_ptr<void>& obj) {
 
 // 当改变fd的事件后需要update负责在poller中更改，epoll调用epoll_ctl
 void Channel::update() {
+    if(edgeTriggered_) {
+        // 边沿触发模式下读写兴趣的变化不需要通知poller
+        int events = pollEvents();
+        if(events == registeredEvents_) {
+            return;
+        }
+        registeredEvents_ = events;
+    }
     loop_->updateChannel(this);
 }
 
@@ -50,21 +61,30 @@ void Channel::handleEvent(Timestamp receiveTime) {
 }
 
 void Channel::handleEventWithGuard(Timestamp reveiveTime) {
-    LOG_INFO("channel handleEvent revents: %d", revents_);
+    LOG_DEBUG("channel handleEvent revents: %d", revents_);
+
+    int revents = revents_;
+    if(edgeTriggered_) {
+        // 注册的是全部事件，只回调当前感兴趣的读写事件，错误与挂断事件照常处理
+        if(!isReading()) revents &= ~(kReadEvent | EPOLLRDHUP);
+        if(!isWriting()) revents &= ~kWriteEvent;
+    }
 
-    if((revents_ & EPOLLHUP) && !(EPOLLIN & revents_) ) {
+    if((revents & EPOLLHUP) && !(EPOLLIN & revents) ) {
         if(closeCallback_) closeCallback_();
     }
 
-    if((revents_ & EPOLLERR)) {
+    // EPOLLERR不一定是连接出错，socket错误队列上有数据(例如MSG_ZEROCOPY的完成通知)时也会报告
+    // 交给errorCallback_区分，不影响下面照常处理读写事件
+    if((revents & EPOLLERR)) {
         if(errorCallback_) errorCallback_();
     }
 
-    if((EPOLLIN | EPOLLPRI) & revents_) {
+    if((EPOLLIN | EPOLLPRI | EPOLLRDHUP) & revents) {
         if(readCallback_) readCallback_(reveiveTime);
     }
 
-    if( revents_ & EPOLLOUT ) {
+    if( revents & EPOLLOUT ) {
         if(writeCallback_) writeCallback_();
     }
 }
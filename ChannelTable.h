@@ -0,0 +1,81 @@
+#ifndef __CHANNELTABLE_H__
+#define __CHANNELTABLE_H__
+
+#include "noncopyable.h"
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+class Channel;
+
+/*
+ Poller中fd到Channel的映射表
+ fd是内核分配的最小可用整数，比较稠密，所以直接用fd做下标的数组保存，
+ 查找不需要哈希，添加也不需要为每个连接分配节点
+
+ 每个槽位带一个代数(generation)，fd每次重新插入时加一
+ Poller在poll返回时记下每个活跃channel的fd与代数，EventLoop分发到它之前再核对一次，
+ 代数变了或者已经被移除，说明本轮前面的回调移除了这个channel，或者关闭fd后由新的Channel复用了，
+ 这个事件属于旧的Channel，直接丢弃
+*/
+class ChannelTable : noncopyable {
+public:
+    ChannelTable() : size_(0) {}
+
+    // 插入fd对应的channel，返回这个fd新的代数
+    uint32_t insert(int fd, Channel* channel) {
+        if(static_cast<size_t>(fd) >= entries_.size()) {
+            size_t n = entries_.empty() ? kInitSize : entries_.size();
+            while(n <= static_cast<size_t>(fd)) {
+                n *= 2;
+            }
+            entries_.resize(n);
+        }
+        Entry& entry = entries_[fd];
+        if(entry.channel == nullptr) {
+            size_++;
+        }
+        entry.channel = channel;
+        return ++entry.generation;
+    }
+
+    void erase(int fd) {
+        if(static_cast<size_t>(fd) < entries_.size() && entries_[fd].channel != nullptr) {
+            entries_[fd].channel = nullptr;
+            size_--;
+        }
+    }
+
+    Channel* find(int fd) const {
+        return static_cast<size_t>(fd) < entries_.size() ? entries_[fd].channel : nullptr;
+    }
+
+    // 代数也一致时才返回channel
+    Channel* find(int fd, uint32_t generation) const {
+        if(static_cast<size_t>(fd) >= entries_.size()) {
+            return nullptr;
+        }
+        const Entry& entry = entries_[fd];
+        return entry.generation == generation ? entry.channel : nullptr;
+    }
+
+    uint32_t generation(int fd) const {
+        return static_cast<size_t>(fd) < entries_.size() ? entries_[fd].generation : 0;
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    static const size_t kInitSize = 64;
+
+    struct Entry {
+        Entry() : channel(nullptr), generation(0) {}
+        Channel* channel;
+        uint32_t generation;
+    };
+
+    std::vector<Entry> entries_;
+    size_t size_;   // 当前保存的channel个数
+};
+
+#endif
@@ -1,11 +1,17 @@
 #include "Poller.h"
 #include "EPollPoller.h"
+#include "IoUringPoller.h"
 #include <stdlib.h>
 
 Poller* Poller::newDefaultPoller(EventLoop* loop) {
     if(::getenv("MUDUO_USE_POLL")) {
         return nullptr; // 生成poll的实例
     }
+    else if(::getenv("MUDUO_USE_IO_URING")) {
+        // 生成io_uring的实例，内核不支持时回退到epoll
+        Poller* poller = IoUringPoller::create(loop);
+        return poller ? poller : new EPollPoller(loop);
+    }
     else {
         return new EPollPoller(loop); // 生成epoll的实例
     }
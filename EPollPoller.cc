@@ -1,6 +1,7 @@
 #include "EPollPoller.h"
 #include "Logger.h"
 #include "Channel.h"
+#include "EventLoop.h"
 
 #include <errno.h>
 #include <unistd.h>
@@ -28,14 +29,14 @@ EPollPoller::~EPollPoller()  {
 
 void EPollPoller::updateChannel(Channel* channel) {
     const int index = channel->index();
-    LOG_INFO("EPollPoller::updateChannel fd = %d events = %d index = %d", 
+    LOG_DEBUG("EPollPoller::updateChannel fd = %d events = %d index = %d", 
             channel->fd(), channel->events(), index);
 
     if(index == kNew || index == kDeleted) {
         if(index == kNew) {
             // 这个channel之前没被添加过
             int fd = channel->fd();
-            channels_[fd] = channel;
+            channels_.insert(fd, channel);
         }
         channel->set_index(kAdded); // 现在这个channel已经添加到channels中了
         update(EPOLL_CTL_ADD, channel);
@@ -65,21 +66,22 @@ void EPollPoller::removeChannel(Channel* channel) {
 }
 
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels) {
-    LOG_INFO("EPollPoller::poll fd total count:%lu", channels_.size());
+    LOG_DEBUG("EPollPoller::poll fd total count:%lu", channels_.size());
 
+    activeKeys_.clear();
     int numEvents = ::epoll_wait(epollfd_, (epoll_event*)(&*events_.begin()), static_cast<int>(events_.size()), timeoutMs);
     int saveErrno = errno;  // 先保存下来
     Timestamp now(Timestamp::now());
 
     if(numEvents > 0) {
-        LOG_INFO("EPollPoller::poll %d events happened", numEvents);
+        LOG_DEBUG("EPollPoller::poll %d events happened", numEvents);
         fillActiveChannels(numEvents, activeChannels);
         if(numEvents == events_.size()) {
             events_.resize(events_.size()*2);
         }
     }
     else if(numEvents == 0) {
-        LOG_INFO("EPollPoller::poll happened\n");
+        LOG_DEBUG("EPollPoller::poll happened\n");
     }
     else {
         if(saveErrno != EINTR) {
@@ -91,11 +93,17 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels) {
 }
 
 // 将epoll_wait返回的发生事件fd的channel放入activeChannels中，交给eventLoop
-void EPollPoller::fillActiveChannels(int numEvents, ChannelList* activeChannels) const {
+void EPollPoller::fillActiveChannels(int numEvents, ChannelList* activeChannels) {
     for(int i = 0; i < numEvents; i++) {
-        Channel* channel = static_cast<Channel*>(events_[i].data.ptr);
+        // 内核在EPOLL_CTL_DEL之后不会再返回这个fd的事件，刚从epoll_wait返回时表中的channel一定对应
+        // 本轮分发期间channel被移除、fd被复用的情况由EventLoop通过isActiveChannelCurrent检查
+        int fd = events_[i].data.fd;
+        Channel* channel = channels_.find(fd);
+        if(channel == nullptr) {
+            continue;
+        }
         channel->set_revents(events_[i].events);
-        activeChannels->push_back(channel);
+        appendActiveChannel(fd, channel, activeChannels);
     }
 }
 
@@ -104,10 +112,10 @@ void EPollPoller::update(int operation, Channel* channel) {
     int fd = channel->fd();
     epoll_event event;
     memset(&event, 0, sizeof(event));
-    event.events = channel->events();   // fd感兴趣的事件
-    event.data.ptr = channel;
-    // event.data.fd = fd;                 // 这个其实不用
+    event.events = channel->pollEvents();   // fd感兴趣的事件
+    event.data.fd = fd;     // 返回事件时据此在channels_中找到channel
 
+    ownerLoop()->stats().recordEpollCtl();
     if(::epoll_ctl(epollfd_, operation, fd, &event) < 0) {
         // 出现异常
         if(operation == EPOLL_CTL_DEL)
@@ -2,12 +2,16 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "TimerQueue.h"
+#include "TimingWheel.h"
 
 #include <sys/eventfd.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <stdlib.h>
 #include <memory>
+#include <algorithm>
 
 // 防止一个线程创建多个EventLoop
 __thread EventLoop *t_loopInThisThread = nullptr;
@@ -28,10 +32,19 @@ EventLoop::EventLoop()
     : looping_(false)
     , quit_(false)
     , threadId_(CurrentThread::tid())
+    , bufferPool_(new BufferPool(::getenv("MUDUO_BUFFER_HUGEPAGES") != nullptr))
     , callingPendingFunctors_(false)
     , poller_(Poller::newDefaultPoller(this))
+    , timerQueue_(new TimerQueue(this))
+    , timingWheel_(new TimingWheel(this))
     , wakeupFd_(createEventfd())
-    , wakeupChannel_(new Channel(this, wakeupFd_)) {
+    , wakeupChannel_(new Channel(this, wakeupFd_))
+    , wakeupState_(kAwake)
+    , wakeupsSaved_(0)
+    , busyPollMaxUs_(0)
+    , busyPollBudgetUs_(0)
+    , idleEwmaUs_(0)
+    , readStaging_(new char[kReadStagingSize]) {
     LOG_DEBUG("EventLoop created %p in thread %d \n", this, threadId_);
     if(t_loopInThisThread) {
         // 这个线程已经创建一个EventLoop了
@@ -62,6 +75,7 @@ void EventLoop::handleRead() {
     if(n != sizeof one) {
         LOG_ERROR("handleRead read %ld instead of 8", n);
     }
+    stats_.recordWakeup();
 
 }
 
@@ -71,11 +85,39 @@ void EventLoop::loop() {
 
     LOG_INFO("eventLoop %p start looping", this);
 
+    // 循环内部的耗时统计都使用单调时钟，pollReturnTime_是给回调使用的墙上时间
+    idleSince_ = Timestamp::monotonic();
     while(!quit_) {
         activeChannel_.clear();
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannel_);
-        for(Channel* channel : activeChannel_) {
-            channel->handleEvent(pollReturnTime_);
+        // 开启busy poll时先自旋，自旋期间wakeupState_为kAwake，其他线程只入队不写eventfd
+        if(busyPollBudgetUs_.load(std::memory_order_relaxed) <= 0 || !busyPoll()) {
+            // 先声明即将阻塞，再检查是否还有待执行的回调或者需要退出
+            // 生产者先入队再读wakeupState_，两边都是seq_cst，至少有一方能看到对方
+            // 要么这里看到回调不阻塞，要么生产者看到kSleeping写eventfd
+            wakeupState_.store(kSleeping);
+            int timeoutMs = (quit_ || !pendingFunctors_.empty()) ? 0 : kPollTimeMs;
+            pollReturnTime_ = poller_->poll(timeoutMs, &activeChannel_);
+            wakeupState_.store(kAwake);
+            pollEnd_ = Timestamp::monotonic();
+            if(busyPollMaxUs_ > 0) {
+                updateBusyPollBudget(pollEnd_.microSecondsSinceEpoch()
+                                     - idleSince_.microSecondsSinceEpoch());
+            }
+        }
+        stats_.recordPoll(pollEnd_.microSecondsSinceEpoch() - idleSince_.microSecondsSinceEpoch(),
+                          activeChannel_.size());
+
+        Timestamp handleEnd(pollEnd_);
+        if(!activeChannel_.empty()) {
+            for(size_t i = 0; i < activeChannel_.size(); i++) {
+                Channel* channel = activeChannel_[i];
+                // 前面的回调可能移除了这个channel，或者关闭fd后由新的Channel复用，此时跳过
+                if(poller_->isActiveChannelCurrent(i, channel)) {
+                    channel->handleEvent(pollReturnTime_);
+                }
+            }
+            handleEnd = Timestamp::monotonic();
+            stats_.recordHandleEvent(handleEnd.microSecondsSinceEpoch() - pollEnd_.microSecondsSinceEpoch());
         }
         // 执行当前EventLoop需要执行的回调操作
         /**
@@ -84,7 +126,14 @@ void EventLoop::loop() {
          * MainLoop事先注册一个回调，需要subloop执行
          * 回调放在doPendingFunctors中
         */
-        doPendingFunctors();
+        size_t functors = doPendingFunctors();
+
+        // 本轮结束的时间，同时也是下一轮开始等待事件的时间
+        idleSince_ = Timestamp::monotonic();
+        if(functors > 0) {
+            stats_.recordPendingFunctors(idleSince_.microSecondsSinceEpoch() - handleEnd.microSecondsSinceEpoch(),
+                                         functors);
+        }
     }
 
     LOG_INFO("eventLoop %p stop looping", this);
@@ -101,22 +150,62 @@ void EventLoop::quit() {
     }
 }
 
+void EventLoop::setBusyPoll(int maxSpinUs) {
+    runInLoop(std::bind(&EventLoop::setBusyPollInLoop, this, maxSpinUs));
+}
+
+void EventLoop::setBusyPollInLoop(int maxSpinUs) {
+    busyPollMaxUs_ = maxSpinUs > 0 ? maxSpinUs : 0;
+    busyPollBudgetUs_.store(busyPollMaxUs_, std::memory_order_relaxed);
+    idleEwmaUs_ = 0;
+    idleSince_ = Timestamp::monotonic();
+}
+
+bool EventLoop::busyPoll() {
+    int64_t deadline = idleSince_.microSecondsSinceEpoch() + busyPollBudgetUs_.load(std::memory_order_relaxed);
+    while(true) {
+        pollReturnTime_ = poller_->poll(0, &activeChannel_);
+        pollEnd_ = Timestamp::monotonic();
+        if(!activeChannel_.empty() || quit_ || !pendingFunctors_.empty()) {
+            updateBusyPollBudget(pollEnd_.microSecondsSinceEpoch()
+                                 - idleSince_.microSecondsSinceEpoch());
+            return true;
+        }
+        if(pollEnd_.microSecondsSinceEpoch() >= deadline) {
+            return false;
+        }
+    }
+}
+
+// 空闲时间较短时，自旋时间取平均空闲时间的两倍，保证大部分事件在自旋期间就能拿到
+// 平均空闲时间超过上限时自旋只会白白占用CPU，此时关闭自旋，直到空闲时间重新变短
+void EventLoop::updateBusyPollBudget(int64_t idleUs) {
+    if(idleUs < 0) {
+        idleUs = 0;
+    }
+    idleEwmaUs_ = (idleEwmaUs_ * 7 + idleUs) / 8;
+    if(idleEwmaUs_ <= busyPollMaxUs_) {
+        busyPollBudgetUs_.store(static_cast<int>(std::min<int64_t>(busyPollMaxUs_, idleEwmaUs_ * 2 + 1)),
+                                std::memory_order_relaxed);
+    }
+    else {
+        busyPollBudgetUs_.store(0, std::memory_order_relaxed);
+    }
+}
+
 // 在当前Loop中执行
 void EventLoop::runInLoop(Functor cb) {
     if(isInLoopThread()) {
         cb();
     }
     else {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
     }
 }
 
 // 把cb放入队列中，唤醒loop所在的线程执行cb
 void EventLoop::queueInLoop(Functor cb) {
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
-    }
+    pendingFunctors_.push(std::move(cb));
 
     // 唤醒相应需要执行上面回调操作的线程
     // || callingPendingFunctors_用来处理以下情况
@@ -128,8 +217,39 @@ void EventLoop::queueInLoop(Functor cb) {
 
 }
 
+// 定时器队列使用单调时钟，墙上时间只在这里换算一次，之后调整系统时间不再影响它
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb) {
+    int64_t delay = time.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
+    if(delay < 0) {
+        delay = 0;  // 已经过去的时间点立即到期
+    }
+    Timestamp when(Timestamp::monotonic().microSecondsSinceEpoch() + delay);
+    return timerQueue_->addTimer(std::move(cb), when, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb) {
+    Timestamp time(addTime(Timestamp::monotonic(), delay));
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb) {
+    Timestamp time(addTime(Timestamp::monotonic(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId) {
+    timerQueue_->cancel(timerId);
+}
+
 // MainLoop接受到新连接后唤醒SubLoop所在的线程，通过向wakeupFd_发送消息实现
+// 只有loop处于kSleeping时才真正写eventfd，并且一轮循环中只有一个线程能写成功
 void EventLoop::wakeup() {
+    int expected = kSleeping;
+    if(!wakeupState_.compare_exchange_strong(expected, kNotified)) {
+        wakeupsSaved_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
     uint64_t i = 1;
     ssize_t n = ::write(wakeupFd_, &i, sizeof(i));
     if(n != sizeof(i)) {
@@ -151,20 +271,17 @@ bool EventLoop::hasChannel(Channel* channel) {
     return poller_->hasChannel(channel);
 }
 
-void EventLoop::doPendingFunctors() {
-    std::vector<Functor> functor;    // 用来装Functor;
-    callingPendingFunctors_ = true;
+bool EventLoop::supportsEdgeTriggered() const {
+    return poller_->supportsEdgeTriggered();
+}
 
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        functor.swap(pendingFunctors_);
-    }
+size_t EventLoop::doPendingFunctors() {
+    callingPendingFunctors_ = true;
 
-    // 这个时候其他的线程又可以向pendingFunctors_中装入回调了
-    for(auto f : functor) {
-        f();
-    }
+    // 无锁取出开始时已经入队的回调，执行期间其他线程可以继续向pendingFunctors_中装入回调
+    size_t n = pendingFunctors_.consume([](Functor& f) { f(); });
 
     callingPendingFunctors_ = false;
+    return n;
 }
 
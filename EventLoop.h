@@ -4,19 +4,27 @@
 #include "noncopyable.h"
 #include "Timestamp.h"
 #include "CurrentThread.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+#include "MpscQueue.h"
+#include "Task.h"
+#include "LoopStats.h"
+#include "BufferPool.h"
 #include <functional>
 #include <vector>
 #include <atomic>
 #include <memory>
-#include <mutex>
 
 class Channel;
 class Poller;
+class TimerQueue;
+class TimingWheel;
 
 // 时间循环类，包含两个大模块 Channel 与 Poller(epoll的抽象)
 class EventLoop : noncopyable {
 public:
-    using Functor = std::function<void(void)>;
+    // 只能移动的回调，常见的回调对象内联存储，投递时不申请堆内存
+    using Functor = Task;
 
     EventLoop();
     ~EventLoop();
@@ -27,12 +35,25 @@ public:
     void quit();
 
     Timestamp pollReturnTime() const { return pollReturnTime_; }
+    // 本轮poll返回的时间，每轮循环只取一次，回调中需要当前时间时用它代替Timestamp::now()
+    Timestamp now() const { return pollReturnTime_; }
 
     // 在当前Loop中执行
     void runInLoop(Functor cb);
     // 把cb放入队列中，唤醒loop所在的线程执行cb
     void queueInLoop(Functor cb);
 
+    // 在time(墙上时间)时刻执行cb，线程安全；加入时换算成单调时钟上的时间点，之后调整系统时间不影响它
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    // delay秒后执行cb，线程安全
+    TimerId runAfter(double delay, TimerCallback cb);
+    // 每隔interval秒执行一次cb，线程安全
+    TimerId runEvery(double interval, TimerCallback cb);
+    // 取消定时器，线程安全
+    void cancel(TimerId timerId);
+    // 当前loop的时间轮，用于连接的空闲超时与写超时，只能在loop线程中使用
+    TimingWheel* timingWheel() const { return timingWheel_.get(); }
+
     // MainLoop接受到新连接后唤醒SubLoop所在的线程，通过向wakeupFd_发送消息实现
     void wakeup();
 
@@ -40,30 +61,80 @@ public:
     void updateChannel(Channel* channel);
     void removeChannel(Channel* channel);
     bool hasChannel(Channel* channel);
+    // 当前poller是否支持Channel的边沿触发模式(io_uring后端不支持)
+    bool supportsEdgeTriggered() const;
 
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
+
+    // 开启自旋轮询(busy poll)，阻塞在epoll_wait之前先以0超时轮询最多maxSpinUs微秒
+    // 实际自旋时间根据观察到的空闲时间自适应调整，maxSpinUs <= 0表示关闭，线程安全
+    void setBusyPoll(int maxSpinUs);
+    // 当前自适应得到的自旋时间，单位微秒，可以在任意线程调用
+    int busyPollBudgetUs() const { return busyPollBudgetUs_.load(std::memory_order_relaxed); }
+
+    // 本loop所有连接共用的读暂存区，未初始化，只在loop线程中使用
+    char* readStagingBuffer() { return readStaging_.get(); }
+    static const size_t kReadStagingSize = 64*1024;
+
+    // 本loop所有连接的Buffer共用的内存池，设置环境变量MUDUO_BUFFER_HUGEPAGES时slab使用大页
+    BufferPool* bufferPool() { return bufferPool_.get(); }
+
+    // 运行统计，loop线程写入，snapshot可以在任意线程调用
+    LoopStats& stats() { return stats_; }
+    const LoopStats& stats() const { return stats_; }
+
+    // 被合并掉的wakeup次数，即省下的eventfd write系统调用次数
+    uint64_t wakeupsSaved() const { return wakeupsSaved_.load(std::memory_order_relaxed); }
 private:
+    // wakeupState_的取值，见EventLoop::loop
+    enum WakeupState {
+        kAwake,     // loop正在处理事件，阻塞前会检查pendingFunctors_，不需要写eventfd
+        kSleeping,  // loop阻塞在(或即将阻塞在)epoll_wait，需要写eventfd唤醒
+        kNotified,  // 已经有线程写过eventfd，其他线程不必再写
+    };
+
     // wakeupFd_的回调
     void handleRead();
-    void doPendingFunctors();
+    // 返回执行的回调个数
+    size_t doPendingFunctors();
+
+    void setBusyPollInLoop(int maxSpinUs);
+    // 自旋阶段，拿到事件或者有待执行的回调时返回true，超过自旋时间返回false
+    bool busyPoll();
+    // 根据本次空闲了多长时间调整自旋时间
+    void updateBusyPollBudget(int64_t idleUs);
 
     using ChannelList = std::vector<Channel*>;
 
     std::atomic_bool looping_;  // 原子操作，底层通过CAS实现，循环是否实现
     std::atomic_bool quit_;      // 表示退出loop循环
     const pid_t threadId_;      // 记录当前loop所在线程的ID
+    // 声明在定时器和回调队列之前，最后析构，保证其中持有的连接先把缓冲区还回来
+    std::unique_ptr<BufferPool> bufferPool_;
     Timestamp pollReturnTime_;  // 记录发生事件的Channel的时间点
     std::unique_ptr<Poller> poller_;
+    std::unique_ptr<TimerQueue> timerQueue_;    // 定时器队列，timerfd注册在poller_中
+    std::unique_ptr<TimingWheel> timingWheel_;  // 时间轮，由timerQueue_驱动，声明在timerQueue_之后保证先析构
 
     int wakeupFd_;      // 当MainLoop获取一个新用户Channel，
                         // 通过轮询选择subLoop，subLoop可能是在挂起状态，通过该成员唤醒subLoop
     std::unique_ptr<Channel> wakeupChannel_;    // 绑定了wakeupFd_，用于唤醒subLoop
+    std::atomic<int> wakeupState_;              // 对应上面的枚举WakeupState，一轮循环最多写一次eventfd
+    std::atomic<uint64_t> wakeupsSaved_;
+
+    int busyPollMaxUs_;         // 自旋时间上限，0表示不自旋
+    std::atomic<int> busyPollBudgetUs_;    // 当前自旋时间，在[0, busyPollMaxUs_]之间自适应，loop线程写入
+    int64_t idleEwmaUs_;        // 空闲时间的指数加权平均
+    Timestamp idleSince_;       // 上一轮处理完事件与回调的时间，单调时钟
+    Timestamp pollEnd_;         // 本轮poll返回的时间，单调时钟
+
+    LoopStats stats_;
+    std::unique_ptr<char[]> readStaging_;
 
     ChannelList activeChannel_;     // Eventloop管理的所有channel
 
     std::atomic_bool callingPendingFunctors_;   // 标识当前loop是否有需要执行的回调
-    std::vector<Functor> pendingFunctors_;  // 存储Loop所有需要执行的回调
-    std::mutex mutex_;                      //  保护pendinfFunctors_容器的线程安全
+    MpscQueue<Functor> pendingFunctors_;    // 存储Loop所有需要执行的回调，无锁多生产者单消费者队列
 };
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "EventLoop.h"
 #include <memory>
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop* baseLoop, const std::string &nameArg) 
@@ -50,3 +51,18 @@ std::vector<EventLoop*> EventLoopThreadPool::getAllLoops() {
     }
 }
 
+std::vector<LoopStats::Snapshot> EventLoopThreadPool::getAllStats() {
+    std::vector<LoopStats::Snapshot> stats;
+    for(EventLoop* loop : getAllLoops()) {
+        stats.push_back(loop->stats().snapshot());
+    }
+    return stats;
+}
+
+std::vector<BufferPool::Snapshot> EventLoopThreadPool::getAllBufferPoolStats() {
+    std::vector<BufferPool::Snapshot> stats;
+    for(EventLoop* loop : getAllLoops()) {
+        stats.push_back(loop->bufferPool()->snapshot());
+    }
+    return stats;
+}
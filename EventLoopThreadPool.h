@@ -2,6 +2,8 @@
 #define __EVENTLOOPTHREADPOOL_H__
 
 #include "noncopyable.h"
+#include "LoopStats.h"
+#include "BufferPool.h"
 #include <functional>
 #include <string>
 #include <vector>
@@ -28,6 +30,11 @@ public:
 
     std::vector<EventLoop*> getAllLoops();
 
+    // 所有处理连接的loop的运行统计，顺序与getAllLoops相同，可以在任意线程调用
+    std::vector<LoopStats::Snapshot> getAllStats();
+    // 所有处理连接的loop的Buffer内存池占用情况，顺序与getAllLoops相同，可以在任意线程调用
+    std::vector<BufferPool::Snapshot> getAllBufferPoolStats();
+
     bool started() const { return started_; }
     const std::string name() const { return name_; }
 
@@ -0,0 +1,336 @@
+#include "IoUringPoller.h"
+#include "Logger.h"
+#include "Channel.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <algorithm>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define MUDUO_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#endif
+#endif
+
+// 与EPollPoller相同，记录在Channel::index中
+// channel未添加到Poller中
+const int kNew = -1;
+// channel已经添加到Poller中
+const int kAdded = 1;
+// channel已经删除过
+const int kDeleted = 2;
+
+#ifdef MUDUO_HAVE_IO_URING
+
+// POLL_REMOVE请求自身的完成事件使用这个user_data，直接丢弃
+static const uint64_t kInternalUserData = UINT64_MAX;
+
+// user_data高32位为注册序号，低32位为fd
+static uint64_t makeUserData(int fd, uint32_t seq) {
+    return (static_cast<uint64_t>(seq) << 32) | static_cast<uint32_t>(fd);
+}
+
+IoUringPoller* IoUringPoller::create(EventLoop* loop) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ringfd = static_cast<int>(::syscall(__NR_io_uring_setup, kRingEntries, &params));
+    if(ringfd < 0) {
+        LOG_ERROR("io_uring_setup error: %d, fall back to epoll\n", errno);
+        return nullptr;
+    }
+    // poll需要带超时时间等待，依赖IORING_ENTER_EXT_ARG(Linux 5.11)
+    if(!(params.features & IORING_FEAT_EXT_ARG)) {
+        LOG_ERROR("io_uring does not support IORING_FEAT_EXT_ARG, fall back to epoll\n");
+        ::close(ringfd);
+        return nullptr;
+    }
+
+    IoUringPoller* poller = new IoUringPoller(loop, ringfd);
+    if(!poller->setupRings(&params)) {
+        delete poller;
+        return nullptr;
+    }
+    return poller;
+}
+
+IoUringPoller::IoUringPoller(EventLoop* loop, int ringfd)
+    : Poller(loop)
+    , ringfd_(ringfd)
+    , sqRing_(MAP_FAILED)
+    , sqRingSize_(0)
+    , sqHead_(nullptr)
+    , sqTail_(nullptr)
+    , sqMask_(0)
+    , sqEntries_(0)
+    , sqes_(static_cast<io_uring_sqe*>(MAP_FAILED))
+    , sqesSize_(0)
+    , sqLocalTail_(0)
+    , toSubmit_(0)
+    , cqRing_(MAP_FAILED)
+    , cqRingSize_(0)
+    , cqHead_(nullptr)
+    , cqTail_(nullptr)
+    , cqMask_(0)
+    , cqes_(nullptr)
+    , nextSeq_(0)
+{}
+
+IoUringPoller::~IoUringPoller() {
+    if(sqes_ != MAP_FAILED) {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if(cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    if(sqRing_ != MAP_FAILED) {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    ::close(ringfd_);
+}
+
+bool IoUringPoller::setupRings(const void* p) {
+    const io_uring_params& params = *static_cast<const io_uring_params*>(p);
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(singleMmap) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQ_RING);
+    if(sqRing_ == MAP_FAILED) {
+        LOG_ERROR("io_uring mmap sq ring error: %d\n", errno);
+        return false;
+    }
+    if(singleMmap) {
+        cqRing_ = sqRing_;
+    }
+    else {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_CQ_RING);
+        if(cqRing_ == MAP_FAILED) {
+            LOG_ERROR("io_uring mmap cq ring error: %d\n", errno);
+            return false;
+        }
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQES));
+    if(sqes_ == MAP_FAILED) {
+        LOG_ERROR("io_uring mmap sqes error: %d\n", errno);
+        return false;
+    }
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqLocalTail_ = *sqTail_;
+    // SQ的索引数组固定为一一对应，SQE按顺序使用
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for(unsigned i = 0; i < sqEntries_; i++) {
+        array[i] = i;
+    }
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+io_uring_sqe* IoUringPoller::getSqe() {
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if(sqLocalTail_ - head >= sqEntries_) {
+        // SQ满了，先把已有的请求提交给内核
+        enter(0, 0);
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if(sqLocalTail_ - head >= sqEntries_) {
+            LOG_FATAL("io_uring submission queue overflow\n");
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sqLocalTail_ & sqMask_];
+    memset(sqe, 0, sizeof(*sqe));
+    sqLocalTail_++;
+    toSubmit_++;
+    return sqe;
+}
+
+int IoUringPoller::enter(unsigned minComplete, int timeoutMs) {
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+
+    unsigned flags = 0;
+    io_uring_getevents_arg arg;
+    timespec ts;
+    void* argp = nullptr;
+    size_t argsz = 0;
+    if(minComplete > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if(timeoutMs >= 0) {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = (timeoutMs % 1000) * 1000 * 1000L;
+            memset(&arg, 0, sizeof(arg));
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+    }
+
+    int ret = static_cast<int>(::syscall(__NR_io_uring_enter, ringfd_, toSubmit_, minComplete,
+                                         flags, argp, argsz));
+    // 内核消费了多少SQE以sqHead_为准
+    toSubmit_ = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    return ret;
+}
+
+void IoUringPoller::arm(Channel* channel, PollState& state) {
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = channel->fd();
+    sqe->poll32_events = static_cast<uint32_t>(channel->events());  // EPOLLIN等与POLLIN等数值相同
+    sqe->user_data = makeUserData(channel->fd(), state.seq);
+    state.armed = true;
+}
+
+void IoUringPoller::disarm(int fd, PollState& state) {
+    if(state.armed) {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = makeUserData(fd, state.seq);
+        sqe->user_data = kInternalUserData;
+        state.armed = false;
+    }
+    // 序号加一，之前请求的完成事件(包括被取消产生的-ECANCELED)都会被丢弃
+    state.seq = nextSeq_++;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList* activeChannels) {
+    // 上一轮触发过的fd重新提交poll请求，此时回调已经执行完，提交时内核会重新检查就绪状态
+    for(int fd : rearmFds_) {
+        Channel* channel = channels_.find(fd);
+        if(channel == nullptr || states_[fd].armed) {
+            continue;
+        }
+        if(channel->index() == kAdded && !channel->isNoneEvent()) {
+            arm(channel, states_[fd]);
+        }
+    }
+    rearmFds_.clear();
+
+    unsigned minComplete = (timeoutMs != 0) ? 1 : 0;
+    int ret = 0;
+    if(minComplete > 0 || toSubmit_ > 0) {
+        // 一次系统调用提交所有变更并等待事件
+        ret = enter(minComplete, timeoutMs);
+    }
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if(ret < 0 && saveErrno != ETIME && saveErrno != EINTR) {
+        errno = saveErrno;
+        LOG_ERROR("IoUringPoller::poll io_uring_enter error: %d\n", saveErrno);
+    }
+    fillActiveChannels(activeChannels);
+    return now;
+}
+
+void IoUringPoller::fillActiveChannels(ChannelList* activeChannels) {
+    activeKeys_.clear();
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for(; head != tail; head++) {
+        const io_uring_cqe* cqe = &cqes_[head & cqMask_];
+        uint64_t userData = cqe->user_data;
+        int res = cqe->res;
+        if(userData == kInternalUserData) {
+            continue;
+        }
+
+        int fd = static_cast<int>(userData & 0xffffffffu);
+        uint32_t seq = static_cast<uint32_t>(userData >> 32);
+        Channel* channel = channels_.find(fd);
+        if(channel == nullptr || states_[fd].seq != seq) {
+            continue;   // channel已经删除或者兴趣已经改变，这是旧请求的完成事件
+        }
+        states_[fd].armed = false;
+
+        channel->set_revents(res >= 0 ? res : static_cast<int>(EPOLLERR));
+        appendActiveChannel(fd, channel, activeChannels);
+        rearmFds_.push_back(fd);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
+
+void IoUringPoller::updateChannel(Channel* channel) {
+    const int index = channel->index();
+    const int fd = channel->fd();
+
+    if(index == kNew || index == kDeleted) {
+        if(index == kNew) {
+            channels_.insert(fd, channel);
+            if(static_cast<size_t>(fd) >= states_.size()) {
+                states_.resize(fd + 1);
+            }
+            PollState state;
+            state.seq = nextSeq_++;
+            state.armed = false;
+            states_[fd] = state;
+        }
+        channel->set_index(kAdded);
+        PollState& state = states_[fd];
+        disarm(fd, state);
+        if(!channel->isNoneEvent()) {
+            arm(channel, state);
+        }
+    }
+    else {
+        PollState& state = states_[fd];
+        if(channel->isNoneEvent()) {
+            disarm(fd, state);
+            channel->set_index(kDeleted);
+        }
+        else if(state.armed) {
+            // 兴趣改变，取消旧请求重新提交，两个SQE在下一次enter中一起提交
+            disarm(fd, state);
+            arm(channel, state);
+        }
+        // 没有等待中的请求说明本轮刚触发过，poll时会按最新的兴趣重新提交
+    }
+}
+
+void IoUringPoller::removeChannel(Channel* channel) {
+    int fd = channel->fd();
+    if(channels_.find(fd) != nullptr) {
+        disarm(fd, states_[fd]);
+    }
+    channels_.erase(fd);
+    channel->set_index(kNew);
+}
+
+#else // MUDUO_HAVE_IO_URING
+
+IoUringPoller* IoUringPoller::create(EventLoop* loop) {
+    LOG_ERROR("built without io_uring support, fall back to epoll\n");
+    return nullptr;
+}
+
+IoUringPoller::~IoUringPoller() {}
+Timestamp IoUringPoller::poll(int, ChannelList*) { return Timestamp::now(); }
+void IoUringPoller::updateChannel(Channel*) {}
+void IoUringPoller::removeChannel(Channel*) {}
+
+#endif // MUDUO_HAVE_IO_URING
@@ -0,0 +1,54 @@
+#include "LengthHeaderCodec.h"
+#include "TcpConnection.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+#include <endian.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+LengthHeaderCodec::LengthHeaderCodec(const FrameCallback& cb, size_t maxFrameLength)
+    : frameCallback_(cb)
+    , maxFrameLength_(maxFrameLength)
+{}
+
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime) {
+    while(buf->readableBytes() >= kHeaderLen) {
+        const int32_t len = buf->peekInt32();
+        if(len < 0 || static_cast<size_t>(len) > maxFrameLength_) {
+            LOG_ERROR("LengthHeaderCodec [%s] invalid frame length %d\n", conn->name().c_str(), len);
+            buf->retrieveAll();
+            conn->forceClose();
+            break;
+        }
+        if(buf->readableBytes() < kHeaderLen + len) {
+            break;  // 帧还不完整，等更多数据
+        }
+        // 在输入缓冲区中原地回调，回调返回后再丢弃这一帧
+        frameCallback_(conn, buf->peek() + kHeaderLen, len, receiveTime);
+        buf->retrieve(kHeaderLen + len);
+    }
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr& conn, const void* data, size_t len) {
+    if(len > static_cast<size_t>(INT32_MAX)) {
+        LOG_ERROR("LengthHeaderCodec [%s] frame too large %zu\n", conn->name().c_str(), len);
+        return;
+    }
+    int32_t be32 = htobe32(static_cast<int32_t>(len));
+    struct iovec vec[2];
+    vec[0].iov_base = &be32;
+    vec[0].iov_len = sizeof(be32);
+    vec[1].iov_base = const_cast<void*>(data);
+    vec[1].iov_len = len;
+    conn->send(vec, 2);
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr& conn, Buffer* buf) {
+    if(buf->readableBytes() > static_cast<size_t>(INT32_MAX)) {
+        LOG_ERROR("LengthHeaderCodec [%s] frame too large %zu\n", conn->name().c_str(), buf->readableBytes());
+        return;
+    }
+    buf->prependInt32(static_cast<int32_t>(buf->readableBytes()));
+    conn->send(buf);
+}
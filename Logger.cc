@@ -1,6 +1,37 @@
 #include "Logger.h"
 #include "Timestamp.h"
-#include <iostream>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+std::atomic<int> Logger::logLevel_(INFO);
+
+static void defaultOutput(const char* msg, int len) {
+    // 一次fwrite写出整行，多线程下不会交错
+    fwrite(msg, 1, len, stdout);
+}
+
+static void defaultFlush() {
+    fflush(stdout);
+}
+
+static Logger::OutputFunc g_output = defaultOutput;
+static Logger::FlushFunc g_flush = defaultFlush;
+
+void Logger::setOutput(OutputFunc out) {
+    g_output = out;
+}
+
+void Logger::setFlush(FlushFunc flush) {
+    g_flush = flush;
+}
+
+static const char* const kLevelNames[] = {
+    "[DEBUG]",
+    "[INFO]",
+    "[ERROR]",
+    "[FATAL]",
+};
 
 // 获取实例对象 单例模式
 Logger& Logger::instance() {
@@ -8,30 +39,36 @@ Logger& Logger::instance() {
     return logger;
 }
 
-// 设置日志级别
-void Logger::setLogLevel(int level) {
-    logLevel_ = level;
-}
-
 // 写日志
-void Logger::log(std::string msg) {
-    switch(logLevel_) {
-        case INFO:
-            std::cout << "[INF0]";
-            break;
-        case ERROR:
-            std::cout << "[ERROR]";
-            break;
-        case FATAL:
-            std::cout << "[FATAL]";
-            break;
-        case DEBUG:
-            std::cout << "[DEBUG]";
-            break;
-        default:
-            break;
+void Logger::log(LogLevel level, const char* logmsgFormat, ...) {
+    // 整条日志先拼在栈上的缓冲区里，不需要清零
+    char buf[1024];
+    size_t nameLen = strlen(kLevelNames[level]);
+    memcpy(buf, kLevelNames[level], nameLen);
+    int len = static_cast<int>(nameLen);
+    len += Timestamp::now().formatTo(buf + len);
+    memcpy(buf + len, " : ", 3);
+    len += 3;
+
+    va_list args;
+    va_start(args, logmsgFormat);
+    int n = vsnprintf(buf + len, sizeof(buf) - len, logmsgFormat, args);
+    va_end(args);
+    if(n > 0) {
+        len += n;
+    }
+    if(len > static_cast<int>(sizeof(buf)) - 2) {
+        len = sizeof(buf) - 2;  // 截断
+    }
+
+    // 很多调用处的格式串自带换行，这里不再重复追加
+    if(buf[len - 1] != '\n') {
+        buf[len++] = '\n';
     }
 
-    std::cout << Timestamp::now().toString() << " : " << msg << std::endl;
+    // 只在FATAL时立即刷新
+    g_output(buf, len);
+    if(level == FATAL) {
+        g_flush();
+    }
 }
-    
@@ -2,60 +2,66 @@
 #define __LOGGER_H__
 
 #include <string>
+#include <atomic>
+#include <stdlib.h>
 #include "noncopyable.h"
 
-#define LOG_INFO(logmsgFormat, ...) \
-    do { \
-        Logger& logger = Logger::instance(); \
-        logger.setLogLevel(INFO); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    }while(0)
-
-#define LOG_ERROR(logmsgFormat, ...) \
-    do { \
-        Logger& logger = Logger::instance(); \
-        logger.setLogLevel(ERROR); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    }while(0)
-
-#define LOG_FATAL(logmsgFormat, ...) \
-    do { \
-        Logger& logger = Logger::instance(); \
-        logger.setLogLevel(FATAL); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-        exit(-1); \
-    }while(0)
+// 日志级别的数值，供预处理器比较使用，与LogLevel一一对应
+#define MUDUO_LOG_LEVEL_DEBUG 0
+#define MUDUO_LOG_LEVEL_INFO  1
+#define MUDUO_LOG_LEVEL_ERROR 2
+#define MUDUO_LOG_LEVEL_FATAL 3
 
+// 编译期最低日志级别，低于它的日志宏展开为空，参数也不会求值
+// 可以通过 -DMUDUO_MIN_LOG_LEVEL=MUDUO_LOG_LEVEL_ERROR 之类的方式修改
+#ifndef MUDUO_MIN_LOG_LEVEL
 #ifdef MUDUEBUG
+#define MUDUO_MIN_LOG_LEVEL MUDUO_LOG_LEVEL_DEBUG
+#else
+#define MUDUO_MIN_LOG_LEVEL MUDUO_LOG_LEVEL_INFO
+#endif
+#endif
 
-#define LOG_DEBUG(logmsgFormat, ...) \
+// 先检查运行期级别，通过了才格式化，级别随调用传入而不是写入共享状态
+#define MUDUO_LOG_IMPL(level, logmsgFormat, ...) \
     do { \
-        Logger& logger = Logger::instance(); \
-        logger.setLogLevel(DEBUG); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        if(Logger::logLevel() <= level) { \
+            Logger::instance().log(level, logmsgFormat, ##__VA_ARGS__); \
+        } \
     }while(0)
 
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(logmsgFormat, ...) MUDUO_LOG_IMPL(DEBUG, logmsgFormat, ##__VA_ARGS__)
 #else
+#define LOG_DEBUG(logmsgFormat, ...) do {}while(0)
+#endif
 
-#define LOG_DEBUG(logmsgFormat, ...)
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_INFO
+#define LOG_INFO(logmsgFormat, ...) MUDUO_LOG_IMPL(INFO, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_INFO(logmsgFormat, ...) do {}while(0)
+#endif
 
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_ERROR
+#define LOG_ERROR(logmsgFormat, ...) MUDUO_LOG_IMPL(ERROR, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(logmsgFormat, ...) do {}while(0)
 #endif
 
-// 定义日志级别 INFO ERROR FATAL DEBUG
+// FATAL不受级别控制，总是输出并退出
+#define LOG_FATAL(logmsgFormat, ...) \
+    do { \
+        Logger::instance().log(FATAL, logmsgFormat, ##__VA_ARGS__); \
+        exit(-1); \
+    }while(0)
+
+// 定义日志级别 DEBUG INFO ERROR FATAL，按严重程度递增
 
 enum LogLevel {
-    INFO,
-    ERROR, 
-    FATAL,
-    DEBUG,
+    DEBUG = MUDUO_LOG_LEVEL_DEBUG,
+    INFO = MUDUO_LOG_LEVEL_INFO,
+    ERROR = MUDUO_LOG_LEVEL_ERROR,
+    FATAL = MUDUO_LOG_LEVEL_FATAL,
 };
 
 // class 默认私有继承
@@ -63,13 +69,21 @@ class Logger : noncopyable {
 public:
     // 获取实例对象 单例模式
     static Logger& instance();
-    // 设置日志级别
-    void setLogLevel(int level);
-    // 写日志
-    void log(std::string msg);
-private:
-    int logLevel_;
+    // 运行期日志级别，低于它的日志在格式化之前就被丢弃，默认INFO
+    static LogLevel logLevel() { return static_cast<LogLevel>(logLevel_.load(std::memory_order_relaxed)); }
+    static void setLogLevel(LogLevel level) { logLevel_.store(level, std::memory_order_relaxed); }
+
+    // 日志的输出目的地，默认写stdout，可以换成AsyncLogging::append
+    using OutputFunc = void (*)(const char* msg, int len);
+    using FlushFunc = void (*)();
+    // 在启动IO线程之前设置
+    static void setOutput(OutputFunc out);
+    static void setFlush(FlushFunc flush);
 
+    // 格式化并写一条日志
+    void log(LogLevel level, const char* logmsgFormat, ...) __attribute__((format(printf, 3, 4)));
+private:
+    static std::atomic<int> logLevel_;
 };
 
 #endif
@@ -0,0 +1,92 @@
+#include "LoopStats.h"
+
+// 值所在的桶，0放在第0个桶，其余为最高位的位置加1
+static int bucketIndex(uint64_t value) {
+    if(value == 0) {
+        return 0;
+    }
+    int index = 64 - __builtin_clzll(value);
+    return index < LoopStats::kHistogramBuckets ? index : LoopStats::kHistogramBuckets - 1;
+}
+
+uint64_t LoopStats::HistogramSnapshot::percentile(double percentile) const {
+    if(count == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(percentile * count);
+    if(target == 0) {
+        target = 1;
+    }
+    uint64_t seen = 0;
+    for(int i = 0; i < kHistogramBuckets; i++) {
+        seen += buckets[i];
+        if(seen >= target) {
+            uint64_t upper = (i == 0) ? 0 : ((1ULL << i) - 1);
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+LoopStats::Histogram::Histogram()
+    : count_(0)
+    , sum_(0)
+    , max_(0)
+{
+    for(int i = 0; i < kHistogramBuckets; i++) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LoopStats::Histogram::add(uint64_t value) {
+    increase(count_, 1);
+    increase(sum_, value);
+    if(value > max_.load(std::memory_order_relaxed)) {
+        max_.store(value, std::memory_order_relaxed);
+    }
+    increase(buckets_[bucketIndex(value)], 1);
+}
+
+void LoopStats::Histogram::snapshot(HistogramSnapshot* out) const {
+    out->count = count_.load(std::memory_order_relaxed);
+    out->sum = sum_.load(std::memory_order_relaxed);
+    out->max = max_.load(std::memory_order_relaxed);
+    for(int i = 0; i < kHistogramBuckets; i++) {
+        out->buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+}
+
+LoopStats::LoopStats()
+    : iterations_(0)
+    , wakeups_(0)
+    , epollCtls_(0)
+    , functors_(0)
+{}
+
+void LoopStats::recordPoll(int64_t blockedUs, size_t numEvents) {
+    increase(iterations_, 1);
+    pollBlockedUs_.add(blockedUs > 0 ? blockedUs : 0);
+    eventsPerPoll_.add(numEvents);
+}
+
+void LoopStats::recordHandleEvent(int64_t us) {
+    handleEventUs_.add(us > 0 ? us : 0);
+}
+
+void LoopStats::recordPendingFunctors(int64_t us, size_t count) {
+    increase(functors_, count);
+    functorUs_.add(us > 0 ? us : 0);
+}
+
+LoopStats::Snapshot LoopStats::snapshot() const {
+    Snapshot snap;
+    snap.iterations = iterations_.load(std::memory_order_relaxed);
+    snap.wakeups = wakeups_.load(std::memory_order_relaxed);
+    snap.epollCtls = epollCtls_.load(std::memory_order_relaxed);
+    snap.functors = functors_.load(std::memory_order_relaxed);
+    pollBlockedUs_.snapshot(&snap.pollBlockedUs);
+    eventsPerPoll_.snapshot(&snap.eventsPerPoll);
+    handleEventUs_.snapshot(&snap.handleEventUs);
+    functorUs_.snapshot(&snap.functorUs);
+    return snap;
+}
@@ -5,6 +5,10 @@ Poller::Poller(EventLoop *loop) : ownerLoop_(loop)
 {}
 
 bool Poller::hasChannel(Channel* channel) const {
-    auto it = channels_.find(channel->fd());
-    return it != channels_.end() && it->second == channel;
+    return channels_.find(channel->fd()) == channel;
+}
+
+bool Poller::isActiveChannelCurrent(size_t index, Channel* channel) const {
+    uint64_t key = activeKeys_[index];
+    return channels_.find(static_cast<int>(key & 0xffffffffu), static_cast<uint32_t>(key >> 32)) == channel;
 }
@@ -3,8 +3,9 @@
 
 #include "noncopyable.h"
 #include "Timestamp.h"
+#include "ChannelTable.h"
 #include <vector>
-#include <unordered_map>
+#include <stdint.h>
 
 class Channel;
 class EventLoop;
@@ -17,7 +18,7 @@ public:
     Poller(EventLoop *loop);
     virtual ~Poller() = default;
 
-    // 通过epoll_wait将发生事件的fd放入activeChannels容器中
+    // 通过epoll_wait将发生事件的fd放入activeChannels容器中，调用时activeChannels为空
     virtual Timestamp poll(int timeoutMs, ChannelList* activeChannels) = 0;
     // 更新通道上感兴趣的事件
     virtual void updateChannel(Channel* channel) = 0;
@@ -26,13 +27,30 @@ public:
 
     // 判断channel是否在Poller中
     bool hasChannel(Channel* channel) const;
+    // 分发事件前检查上一次poll返回的第index个channel是否仍然有效
+    // 前面的回调可能已经移除了它，甚至关闭了fd、由新的Channel复用了这个fd，此时channel可能已经析构
+    // 只比较poll时记下的fd与代数，不访问channel
+    bool isActiveChannelCurrent(size_t index, Channel* channel) const;
+    // 是否支持Channel的边沿触发模式
+    virtual bool supportsEdgeTriggered() const { return false; }
     // 获取事件循环的默认Poller
     static Poller* newDefaultPoller(EventLoop* loop);
 protected:
+    EventLoop* ownerLoop() const { return ownerLoop_; }
+
+    // 子类在poll中通过它把发生事件的channel放入activeChannels，同时记下fd与当前的代数
+    void appendActiveChannel(int fd, Channel* channel, ChannelList* activeChannels) {
+        activeKeys_.push_back((static_cast<uint64_t>(channels_.generation(fd)) << 32) | static_cast<uint32_t>(fd));
+        activeChannels->push_back(channel);
+    }
+
     // socketfd : channel
-    using ChannelMap = std::unordered_map<int, Channel*>;
+    using ChannelMap = ChannelTable;
     ChannelMap channels_;
 
+    // 与上一次poll返回的activeChannels一一对应，(代数 << 32) | fd，每次poll开始时清空
+    std::vector<uint64_t> activeKeys_;
+
 private:
     EventLoop *ownerLoop_;
 };
@@ -0,0 +1,130 @@
+#ifndef __TASK_H__
+#define __TASK_H__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * 只能移动的无参回调，替代EventLoop中的std::function<void()>
+ * 内部带有kInlineSize字节的存储空间，常见的std::bind(&TcpConnection::xxx, shared_ptr, ...)
+ * 或者捕获少量变量的lambda直接构造在对象内部，不需要申请堆内存
+ * 超过内联空间、或者移动构造可能抛异常的可调用对象才放到堆上
+*/
+class Task {
+public:
+    static const size_t kInlineSize = 56;   // 加上ops_指针正好一个缓存行
+
+    Task() noexcept : ops_(nullptr) {}
+
+    template<typename F,
+             typename = typename std::enable_if<
+                 !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F&& f) : ops_(nullptr) {
+        using Functor = typename std::decay<F>::type;
+        construct<Functor>(std::forward<F>(f), std::integral_constant<bool, fitsInline<Functor>()>());
+    }
+
+    Task(Task&& other) noexcept : ops_(other.ops_) {
+        if(ops_) {
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if(this != &other) {
+            reset();
+            if(other.ops_) {
+                other.ops_->move(&storage_, &other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops_->invoke(&storage_); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+private:
+    // 手写的虚函数表，每种可调用类型对应一个静态实例
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src);    // 把src移动到dst，并析构src
+        void (*destroy)(void* storage);
+    };
+
+    using Storage = typename std::aligned_storage<kInlineSize, alignof(void*)>::type;
+
+    template<typename F>
+    static constexpr bool fitsInline() {
+        return sizeof(F) <= kInlineSize
+            && alignof(F) <= alignof(Storage)
+            && std::is_nothrow_move_constructible<F>::value;
+    }
+
+    // 可调用对象直接构造在storage_中
+    template<typename F>
+    struct InlineOps {
+        static void invoke(void* storage) { (*static_cast<F*>(storage))(); }
+        static void move(void* dst, void* src) {
+            F* f = static_cast<F*>(src);
+            ::new(dst) F(std::move(*f));
+            f->~F();
+        }
+        static void destroy(void* storage) { static_cast<F*>(storage)->~F(); }
+        static const Ops ops;
+    };
+
+    // storage_中只保存指向堆上可调用对象的指针
+    template<typename F>
+    struct HeapOps {
+        static F*& ptr(void* storage) { return *static_cast<F**>(storage); }
+        static void invoke(void* storage) { (*ptr(storage))(); }
+        static void move(void* dst, void* src) { ::new(dst) F*(ptr(src)); }
+        static void destroy(void* storage) { delete ptr(storage); }
+        static const Ops ops;
+    };
+
+    template<typename F, typename Arg>
+    void construct(Arg&& f, std::true_type) {
+        ::new(&storage_) F(std::forward<Arg>(f));
+        ops_ = &InlineOps<F>::ops;
+    }
+
+    template<typename F, typename Arg>
+    void construct(Arg&& f, std::false_type) {
+        ::new(&storage_) F*(new F(std::forward<Arg>(f)));
+        ops_ = &HeapOps<F>::ops;
+    }
+
+    void reset() {
+        if(ops_) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    Storage storage_;
+    const Ops* ops_;
+};
+
+template<typename F>
+const Task::Ops Task::InlineOps<F>::ops = {
+    &Task::InlineOps<F>::invoke, &Task::InlineOps<F>::move, &Task::InlineOps<F>::destroy
+};
+
+template<typename F>
+const Task::Ops Task::HeapOps<F>::ops = {
+    &Task::HeapOps<F>::invoke, &Task::HeapOps<F>::move, &Task::HeapOps<F>::destroy
+};
+
+#endif
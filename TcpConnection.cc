@@ -8,8 +8,25 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
 #include <strings.h>
 #include <netinet/tcp.h>
+#include <netinet/in.h>
+#include <string.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/errqueue.h>)
+#include <linux/errqueue.h>
+#endif
+#endif
+
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define MUDUO_HAVE_ZEROCOPY 1
+#endif
 
 static EventLoop* CheckLoopNotNull(EventLoop* loop) {
     if(loop) {
@@ -34,6 +51,14 @@ TcpConnection::TcpConnection(EventLoop* loop,
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
     , highWaterMark_(64 * 1024 * 1024)  // 64M
+    , inputBuffer_(loop->bufferPool())
+    , outputBuffer_(loop->bufferPool())
+    , zeroCopyThreshold_(0)
+    , flowHighMark_(0)
+    , flowLowMark_(0)
+    , flowPaused_(false)
+    , idleTimeout_(0.0)
+    , writeTimeout_(0.0)
 {
     // 给channel设置回调函数，poller给channel通知感兴趣的事件发生
     channel_->setReadCallback(
@@ -48,6 +73,9 @@ TcpConnection::TcpConnection(EventLoop* loop,
     channel_->setErrorCallback(
         std::bind(&TcpConnection::handleError, this)
     );
+    // 时间轮节点超时回调，连接关闭时节点会从时间轮上摘下，所以这里可以直接绑定this
+    idleNode_.setCallback(std::bind(&TcpConnection::handleIdleTimeout, this));
+    writeNode_.setCallback(std::bind(&TcpConnection::handleWriteTimeout, this));
 
     LOG_INFO("TcpConnection::ctor[%s] at fd = %d\n", name_.c_str(), sockfd);
     socket_->setKeepAlive(true);    // Tcp保活机制
@@ -57,10 +85,21 @@ TcpConnection::~TcpConnection() {
     LOG_INFO("TcpConnection::ctor[%s] at fd = %d close\n", name_.c_str(), channel_->fd());
 }
 
+void TcpConnection::setEdgeTriggered(bool on) {
+    channel_->setEdgeTriggered(on && loop_->supportsEdgeTriggered());
+}
+
 void TcpConnection::handleRead(Timestamp receiveTime) {
+    if(channel_->edgeTriggered()) {
+        handleReadEdgeTriggered(receiveTime);
+        return;
+    }
+
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno,
+                                    loop_->readStagingBuffer(), EventLoop::kReadStagingSize);
     if(n > 0) {
+        touchIdle();
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
     }
     else if(n == 0) {
@@ -74,26 +113,64 @@ void TcpConnection::handleRead(Timestamp receiveTime) {
 
 }
 
+// 边沿触发模式下必须读到EAGAIN，否则之后不会再有新的通知
+// 为了公平，一次最多读kEdgeTriggeredReadBudget字节，没读完的部分放到loop的回调队列中，先处理其他连接
+void TcpConnection::handleReadEdgeTriggered(Timestamp receiveTime) {
+    if(state_ == kDisconnected || !channel_->isReading()) {
+        return;
+    }
+
+    int savedErrno = 0;
+    bool eof = false;
+    ssize_t n = inputBuffer_.readFdUntilAgain(channel_->fd(), kEdgeTriggeredReadBudget, &savedErrno, &eof,
+                                              loop_->readStagingBuffer(), EventLoop::kReadStagingSize);
+    if(n > 0) {
+        touchIdle();
+        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        if(eof) {
+            if(state_ != kDisconnected) {
+                handleClose();
+            }
+        }
+        else if(savedErrno != EAGAIN) {
+            loop_->queueInLoop(std::bind(&TcpConnection::handleRead, shared_from_this(), receiveTime));
+        }
+    }
+    else if(n == 0) {
+        handleClose();
+    }
+    else if(savedErrno != EAGAIN) {
+        errno = savedErrno;
+        LOG_ERROR("TcpConnection::handleRead ");
+        handleError();
+    }
+}
+
 void TcpConnection::handleWrite() {
+    if(channel_->edgeTriggered()) {
+        handleWriteEdgeTriggered();
+        return;
+    }
+
     if(channel_->isWriting()) {
         int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno, zeroCopyThreshold_);
         if(n > 0) {
             outputBuffer_.retrieve(n);
+            updateFlowControl();
+            touchIdle();
+            touchWrite();
             if(outputBuffer_.readableBytes() == 0) {
                 // writeIndex = readIndex 数据写完了
-                channel_->disableWriting();
-                if(writeCompleteCallback_) {
-                    loop_->queueInLoop(
-                        std::bind(writeCompleteCallback_, shared_from_this()));
-                }
-                if(state_ == kDisconnecting) {
-                    shutdownInLoop();
-                }
+                handleWriteComplete();
             }
         }
         else {
             LOG_ERROR("TcpConnection handleWrite %d\n", savedErrno);
+            if(savedErrno == ENODATA) {
+                // sendFile的文件被截断，剩下的区间发不出去了
+                forceCloseInLoop();
+            }
         }
     }
     else {
@@ -101,10 +178,87 @@ void TcpConnection::handleWrite() {
     }
 }
 
+// 边沿触发模式下必须写到EAGAIN或者写完，否则之后不会再有可写通知
+// writeFd一次只发一段连续的内存片段(最多IOV_MAX个)或者一个文件区间，没遇到EAGAIN也可能有剩余，所以循环写
+// 与读一样一次最多写kEdgeTriggeredWriteBudget字节，没写完的部分放到loop的回调队列中
+void TcpConnection::handleWriteEdgeTriggered() {
+    if(state_ == kDisconnected || !channel_->isWriting()) {
+        return;
+    }
+
+    size_t total = 0;
+    int savedErrno = 0;
+    while(outputBuffer_.readableBytes() > 0 && total < kEdgeTriggeredWriteBudget) {
+        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno, zeroCopyThreshold_);
+        if(n > 0) {
+            outputBuffer_.retrieve(n);
+            total += n;
+        }
+        else if(n < 0 && savedErrno == EINTR) {
+            continue;
+        }
+        else {
+            break;
+        }
+    }
+
+    if(total > 0) {
+        updateFlowControl();
+        touchIdle();
+        touchWrite();
+    }
+    if(outputBuffer_.readableBytes() == 0) {
+        handleWriteComplete();
+    }
+    else if(total >= kEdgeTriggeredWriteBudget) {
+        loop_->queueInLoop(std::bind(&TcpConnection::handleWrite, shared_from_this()));
+    }
+    else if(savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) {
+        LOG_ERROR("TcpConnection handleWrite %d\n", savedErrno);
+        if(savedErrno == ENODATA) {
+            forceCloseInLoop();
+        }
+    }
+}
+
+void TcpConnection::handleWriteComplete() {
+    channel_->disableWriting();
+    loop_->timingWheel()->cancel(&writeNode_);
+    if(writeCompleteCallback_) {
+        loop_->queueInLoop(
+            std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if(state_ == kDisconnecting) {
+        shutdownInLoop();
+    }
+}
+
+void TcpConnection::startWriting() {
+    if(channel_->isWriting()) {
+        return;
+    }
+    channel_->enableWriting();
+    touchWrite();   // 开始等待可写，启动写超时检测
+    if(channel_->edgeTriggered()) {
+        // 边沿触发模式下enableWriting不会让poller重新报告可写，前面直接发送时不一定写到了EAGAIN，主动再写一次
+        loop_->queueInLoop(std::bind(&TcpConnection::handleWrite, shared_from_this()));
+    }
+}
+
 void TcpConnection::handleClose() {
-    LOG_INFO("fd = %d state = %d \n", channel_->fd(), (int)state_);
+    LOG_DEBUG("fd = %d state = %d \n", channel_->fd(), (int)state_);
+    handleErrorQueue();     // 之后不再处理EPOLLERR，先收走已经到达的完成通知
     setState(kDisconnected);
     channel_->disableAll();
+    cancelTimeouts();
+    if(flowPaused_) {
+        // 不再有数据要转发，不能让上游一直停着
+        flowPaused_ = false;
+        TcpConnectionPtr upstream = flowUpstream_.lock();
+        if(upstream) {
+            upstream->startRead();
+        }
+    }
 
     TcpConnectionPtr connPtr(shared_from_this());
     connectionCallback_(connPtr);
@@ -112,6 +266,9 @@ void TcpConnection::handleClose() {
 }
 
 void TcpConnection::handleError() {
+    // 错误队列上有数据时也会报告EPOLLERR，MSG_ZEROCOPY的完成通知就是这样送达的，并不是连接出错
+    handleErrorQueue();
+
     int optval;
     socklen_t optlen = sizeof(optval);
     int err = 0;
@@ -121,25 +278,239 @@ void TcpConnection::handleError() {
     else {
         err = optval;
     }
-    LOG_ERROR("TcpConnection::handleError name%s - SO_ERROR: %d\n", name_.c_str(), err);
+    if(err != 0) {
+        LOG_ERROR("TcpConnection::handleError name%s - SO_ERROR: %d\n", name_.c_str(), err);
+    }
+}
+
+void TcpConnection::handleErrorQueue() {
+#ifdef MUDUO_HAVE_ZEROCOPY
+    char control[128];
+    for(;;) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if(::recvmsg(channel_->fd(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;  // EAGAIN，错误队列已经读空
+        }
+        for(struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+            if(!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+               !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+            const struct sock_extended_err* ee = reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cm));
+            if(ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            // ee_info到ee_data这些序号的发送已经完成，内核不再引用对应的内存
+            outputBuffer_.zeroCopyCompleted(ee->ee_info, ee->ee_data);
+            if((ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) && zeroCopyThreshold_ > 0) {
+                // 内核还是做了拷贝，再用MSG_ZEROCOPY只会多出锁定内存和完成通知的开销
+                LOG_DEBUG("TcpConnection [%s] zerocopy fell back to copying, disabled\n", name_.c_str());
+                zeroCopyThreshold_ = 0;
+            }
+        }
+    }
+#endif
 }
 
 void TcpConnection::send(const std::string& buf) {
+    send(buf.data(), buf.size());
+}
+
+void TcpConnection::send(std::string&& buf) {
+    if(state_ == kConnected) {
+        if(loop_->isInLoopThread()) {
+            sendInLoop(buf.data(), buf.size());
+        }
+        else {
+            queueSend(std::move(buf));
+        }
+    }
+}
+
+void TcpConnection::send(const void* data, size_t len) {
+    if(state_ == kConnected) {
+        if(loop_->isInLoopThread()) {
+            sendInLoop(data, len);
+        }
+        else {
+            // 调用返回后data可能失效，拷贝一份交给loop线程
+            queueSend(std::string(static_cast<const char*>(data), len));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer* buf) {
+    if(state_ == kConnected) {
+        if(loop_->isInLoopThread()) {
+            sendInLoop(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+        }
+        else {
+            queueSend(buf->retrieveAllAsString());
+        }
+    }
+}
+
+void TcpConnection::queueSend(std::string&& data) {
+    // 移进shared_ptr，在loop线程中作为共享切片发送，发不完的部分也不用再拷贝进输出缓冲区
+    std::shared_ptr<const std::string> payload = std::make_shared<std::string>(std::move(data));
+    loop_->runInLoop(std::bind(
+        &TcpConnection::sendSharedInLoop,
+        shared_from_this(), std::move(payload)
+    ));
+}
+
+void TcpConnection::send(const struct iovec* iov, int iovcnt) {
+    if(state_ == kConnected) {
+        if(loop_->isInLoopThread()) {
+            sendvInLoop(iov, iovcnt);
+        }
+        else {
+            // iov指向的数据在调用返回后可能失效，拷贝一份交给loop线程
+            std::string data;
+            for(int i = 0; i < iovcnt; i++) {
+                data.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+            }
+            queueSend(std::move(data));
+        }
+    }
+}
+
+void TcpConnection::sendInLoop(const void* data, size_t len) {
+    struct iovec vec;
+    vec.iov_base = const_cast<void*>(data);
+    vec.iov_len = len;
+    sendvInLoop(&vec, 1);
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t length) {
+    if(state_ != kConnected) {
+        return;
+    }
+    int dupFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if(dupFd < 0) {
+        LOG_ERROR("TcpConnection::sendFile dup fd %d errno %d\n", fd, errno);
+        return;
+    }
+    if(loop_->isInLoopThread()) {
+        sendFileInLoop(dupFd, offset, length);
+    }
+    else {
+        loop_->runInLoop(std::bind(
+            &TcpConnection::sendFileInLoop,
+            shared_from_this(), dupFd, offset, length
+        ));
+    }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length) {
+    if(state_ == kDisconnected) {
+        ::close(fd);
+        LOG_ERROR("disconnection, give up writing!\n");
+        return;
+    }
+
+    if(!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
+        // 前面没有排队的数据，直接从文件发送，发不完的部分等EPOLLOUT后在handleWrite中继续
+        while(length > 0) {
+            ssize_t n = ::sendfile(channel_->fd(), fd, &offset, length);
+            if(n > 0) {
+                length -= n;
+                touchIdle();
+                continue;
+            }
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            if(n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                // 文件被截断或者连接出错，对端收不到完整的数据，直接断开
+                LOG_ERROR("TcpConnection::sendFileInLoop fd %d errno %d\n", fd, n == 0 ? ENODATA : errno);
+                ::close(fd);
+                forceCloseInLoop();
+                return;
+            }
+            break;
+        }
+        if(length == 0) {
+            ::close(fd);
+            if(writeCompleteCallback_) {
+                loop_->queueInLoop(
+                    std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+            return;
+        }
+    }
+
+    // 剩余的区间排在已有数据后面，文件内容不计入高水位，它不占用内存
+    outputBuffer_.appendFile(fd, offset, length);
+    updateFlowControl();
+    startWriting();
+}
+
+void TcpConnection::send(const std::shared_ptr<const std::string>& payload) {
     if(state_ == kConnected) {
         if(loop_->isInLoopThread()) {
-            sendInLoop(buf.c_str(), buf.size());
+            sendSharedInLoop(payload);
         }
         else {
             loop_->runInLoop(std::bind(
-                &TcpConnection::sendInLoop,
-                this, buf.c_str(), buf.size()
+                &TcpConnection::sendSharedInLoop,
+                shared_from_this(), payload
             ));
         }
     }
 }
 
+void TcpConnection::sendSharedInLoop(const std::shared_ptr<const std::string>& payload) {
+    if(state_ == kDisconnected) {
+        LOG_ERROR("disconnection, give up writing!\n");
+        return;
+    }
+
+    // payload整体作为一个切片挂到outputBuffer_后面，不拷贝，再按handleWrite的方式立即尝试发送
+    size_t oldLen = outputBuffer_.readableBytes();
+    outputBuffer_.appendShared(payload, payload->data(), payload->size());
+    if(!channel_->isWriting() && oldLen == 0) {
+        int savedErrno = 0;
+        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno, zeroCopyThreshold_);
+        if(n > 0) {
+            outputBuffer_.retrieve(n);
+            touchIdle();
+        }
+        else if(n < 0 && savedErrno != EWOULDBLOCK && savedErrno != EAGAIN) {
+            LOG_ERROR("TcpConnection::sendSharedInLoop\n");
+            if(savedErrno == EPIPE || savedErrno == ECONNRESET) {
+                return;
+            }
+        }
+        if(outputBuffer_.readableBytes() == 0) {
+            if(writeCompleteCallback_) {
+                loop_->queueInLoop(
+                    std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+            return;
+        }
+    }
+
+    size_t newLen = outputBuffer_.readableBytes();
+    if(newLen >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_) {
+        loop_->queueInLoop(
+            std::bind(highWaterMarkCallback_, shared_from_this(), newLen)
+        );
+    }
+    updateFlowControl();
+    startWriting();
+}
+
 // 发送数据，应用写的快，内核发的满，需要缓冲区，并设置水位回调
-void TcpConnection::sendInLoop(const void* data, size_t len) {
+void TcpConnection::sendvInLoop(const struct iovec* iov, int iovcnt) {
+    size_t len = 0;
+    for(int i = 0; i < iovcnt; i++) {
+        len += iov[i].iov_len;
+    }
     ssize_t nwrote = 0;
     size_t remaining = len;
     bool faultError = false;
@@ -151,7 +522,8 @@ void TcpConnection::sendInLoop(const void* data, size_t len) {
 
     if(!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
         // 之前channel对写事件不感兴趣，或者当前outputBuffer_没有待发送数据
-        nwrote = ::write(channel_->fd(), data, len);
+        // 所有片段用一次writev发出，超过IOV_MAX的部分放进缓冲区
+        nwrote = ::writev(channel_->fd(), iov, iovcnt < IOV_MAX ? iovcnt : IOV_MAX);
         if(nwrote >= 0) {
             remaining = len - nwrote;   // 还有多少数据没发
             if(remaining == 0 && writeCompleteCallback_) {
@@ -183,12 +555,23 @@ void TcpConnection::sendInLoop(const void* data, size_t len) {
             loop_->queueInLoop(
                 std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining)
             );
-            outputBuffer_.append((char*)data + nwrote, remaining);
+        }
 
-            if(!channel_->isWriting()) {
-                channel_->enableWriting();
+        // 跳过已经写出的部分，其余的按片段追加到outputBuffer_
+        size_t skip = nwrote;
+        for(int i = 0; i < iovcnt; i++) {
+            const char* base = static_cast<const char*>(iov[i].iov_base);
+            size_t n = iov[i].iov_len;
+            if(skip >= n) {
+                skip -= n;
+                continue;
             }
+            outputBuffer_.append(base + skip, n - skip);
+            skip = 0;
         }
+        updateFlowControl();
+        // 超过IOV_MAX时第一次writev可能全部写出而没有遇到EAGAIN，边沿触发模式下由startWriting接着写
+        startWriting();
     }
 }
 
@@ -197,6 +580,7 @@ void TcpConnection::connectEstablished() {
     setState(kConnected);
     channel_->tie(shared_from_this());
     channel_->enableReading();
+    touchIdle();
 
     // 新连接建立，调用回调
     connectionCallback_(shared_from_this());
@@ -209,7 +593,22 @@ void TcpConnection::connectDestoryed() {
         channel_->disableAll();
         connectionCallback_(shared_from_this());
     }
+    cancelTimeouts();
     channel_->remove();
+    releaseZeroCopyPending();
+}
+
+void TcpConnection::releaseZeroCopyPending() {
+    handleErrorQueue();
+    std::vector<std::shared_ptr<const void>> owners = outputBuffer_.releaseZeroCopyPending();
+    if(owners.empty()) {
+        return;
+    }
+    // socket随TcpConnection一起关闭，之后读不到完成通知，但内核可能还在发送这些内存
+    // 交给loop的定时器持有，过一段时间再释放
+    LOG_DEBUG("TcpConnection [%s] %zu zerocopy sends still in flight\n", name_.c_str(), owners.size());
+    auto holder = std::make_shared<std::vector<std::shared_ptr<const void>>>(std::move(owners));
+    loop_->runAfter(kZeroCopyLingerSeconds, [holder] {});
 }
 
 void TcpConnection::shutdown() {
@@ -225,3 +624,166 @@ void TcpConnection::shutdownInLoop() {
     }
 }
 
+
+void TcpConnection::forceClose() {
+    if(state_ == kConnected || state_ == kDisconnecting) {
+        setState(kDisconnecting);
+        loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop() {
+    if(state_ == kConnected || state_ == kDisconnecting) {
+        // 与对端关闭连接的处理相同
+        handleClose();
+    }
+}
+
+void TcpConnection::setIdleTimeout(double seconds) {
+    loop_->runInLoop(std::bind(&TcpConnection::setIdleTimeoutInLoop, shared_from_this(), seconds));
+}
+
+void TcpConnection::setWriteTimeout(double seconds) {
+    loop_->runInLoop(std::bind(&TcpConnection::setWriteTimeoutInLoop, shared_from_this(), seconds));
+}
+
+void TcpConnection::startRead() {
+    loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopRead() {
+    loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop() {
+    if(state_ == kDisconnected || (reading_ && channel_->isReading())) {
+        return;
+    }
+    channel_->enableReading();
+    reading_ = true;
+    if(channel_->edgeTriggered()) {
+        // 暂停期间到达的数据的边沿已经错过了，不会再有通知，主动读一次
+        loop_->queueInLoop(std::bind(&TcpConnection::handleRead, shared_from_this(), loop_->now()));
+    }
+}
+
+void TcpConnection::stopReadInLoop() {
+    if(state_ == kDisconnected || (!reading_ && !channel_->isReading())) {
+        return;
+    }
+    channel_->disableReading();
+    reading_ = false;
+}
+
+void TcpConnection::setFlowControl(const TcpConnectionPtr& upstream, size_t highMark, size_t lowMark) {
+    loop_->runInLoop(std::bind(&TcpConnection::setFlowControlInLoop, shared_from_this(),
+                               std::weak_ptr<TcpConnection>(upstream), highMark, lowMark));
+}
+
+void TcpConnection::setFlowControlInLoop(const std::weak_ptr<TcpConnection>& upstream, size_t highMark, size_t lowMark) {
+    if(flowPaused_) {
+        // 换了上游或者关闭流量控制，先恢复原来上游的读取
+        flowPaused_ = false;
+        TcpConnectionPtr old = flowUpstream_.lock();
+        if(old) {
+            old->startRead();
+        }
+    }
+    flowUpstream_ = upstream;
+    flowHighMark_ = highMark;
+    flowLowMark_ = lowMark < highMark ? lowMark : highMark;
+    updateFlowControl();
+}
+
+void TcpConnection::updateFlowControl() {
+    if(flowHighMark_ == 0) {
+        return;
+    }
+    size_t len = outputBuffer_.readableBytes();
+    if(!flowPaused_ && len > flowHighMark_) {
+        flowPaused_ = true;
+        TcpConnectionPtr upstream = flowUpstream_.lock();
+        if(upstream) {
+            upstream->stopRead();
+        }
+    }
+    else if(flowPaused_ && len <= flowLowMark_) {
+        flowPaused_ = false;
+        TcpConnectionPtr upstream = flowUpstream_.lock();
+        if(upstream) {
+            upstream->startRead();
+        }
+    }
+}
+
+void TcpConnection::setZeroCopy(bool on, size_t threshold) {
+    loop_->runInLoop(std::bind(&TcpConnection::setZeroCopyInLoop, shared_from_this(), on, threshold));
+}
+
+void TcpConnection::setZeroCopyInLoop(bool on, size_t threshold) {
+    if(!on || threshold == 0) {
+        zeroCopyThreshold_ = 0;
+        return;
+    }
+#ifdef MUDUO_HAVE_ZEROCOPY
+    int optval = 1;
+    if(::setsockopt(channel_->fd(), SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) == 0) {
+        zeroCopyThreshold_ = threshold;
+        return;
+    }
+    LOG_ERROR("TcpConnection::setZeroCopy [%s] SO_ZEROCOPY errno %d\n", name_.c_str(), errno);
+#else
+    LOG_ERROR("TcpConnection::setZeroCopy [%s] MSG_ZEROCOPY is not supported\n", name_.c_str());
+#endif
+}
+
+void TcpConnection::setIdleTimeoutInLoop(double seconds) {
+    idleTimeout_ = seconds;
+    if(idleTimeout_ > 0.0) {
+        touchIdle();
+    }
+    else {
+        loop_->timingWheel()->cancel(&idleNode_);
+    }
+}
+
+void TcpConnection::setWriteTimeoutInLoop(double seconds) {
+    writeTimeout_ = seconds;
+    if(writeTimeout_ > 0.0) {
+        if(channel_->isWriting()) {
+            touchWrite();
+        }
+    }
+    else {
+        loop_->timingWheel()->cancel(&writeNode_);
+    }
+}
+
+void TcpConnection::touchIdle() {
+    if(idleTimeout_ > 0.0 && state_ != kDisconnected) {
+        loop_->timingWheel()->schedule(&idleNode_, idleTimeout_);
+    }
+}
+
+void TcpConnection::touchWrite() {
+    if(writeTimeout_ > 0.0 && state_ != kDisconnected) {
+        loop_->timingWheel()->schedule(&writeNode_, writeTimeout_);
+    }
+}
+
+void TcpConnection::cancelTimeouts() {
+    loop_->timingWheel()->cancel(&idleNode_);
+    loop_->timingWheel()->cancel(&writeNode_);
+}
+
+void TcpConnection::handleIdleTimeout() {
+    LOG_INFO("TcpConnection::handleIdleTimeout [%s] idle for %.1f seconds, force close\n",
+        name_.c_str(), idleTimeout_);
+    forceCloseInLoop();
+}
+
+void TcpConnection::handleWriteTimeout() {
+    LOG_INFO("TcpConnection::handleWriteTimeout [%s] write stalled for %.1f seconds, force close\n",
+        name_.c_str(), writeTimeout_);
+    forceCloseInLoop();
+}
@@ -5,6 +5,7 @@
 #include <functional>
 #include <string>
 #include <strings.h>
+#include <future>
 
 static EventLoop* CheckLoopNotNull(EventLoop* loop) {
     if(loop) {
@@ -18,17 +19,29 @@ static EventLoop* CheckLoopNotNull(EventLoop* loop) {
 TcpServer::TcpServer(EventLoop* loop, const InetAddress& listenAddr, 
                      std::string nameArg, Option option)
     : loop_(loop)
+    , listenAddr_(listenAddr)
     , ipPort_(listenAddr.toIpPort())
     , name_(nameArg)
-    , acceptor_(new Acceptor(loop_, listenAddr, option == kReusePort))
+    , option_(option)
+    , acceptor_()
     , threadPool_(new EventLoopThreadPool(loop_, name_))
     , connectionCallback_()
     , messageCallback_()
     , nextConnId_(1)
     , started_(0)
+    , busyPollUs_(0)
+    , edgeTriggered_(false)
+    , acceptBatch_(Acceptor::kDefaultAcceptBatch)
+    , listenAddrSpecific_(listenAddr.getSockAddr()->sin_addr.s_addr != htonl(INADDR_ANY)
+                          && listenAddr.toPort() != 0)
 { 
-    acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
-                                        std::placeholders::_1, std::placeholders::_2));
+}
+
+// 在subLoop中依次建立一批连接
+static void establishConnections(std::vector<TcpConnectionPtr>& conns) {
+    for(const TcpConnectionPtr& conn : conns) {
+        conn->connectEstablished();
+    }
 }
 
 TcpServer::~TcpServer() {
@@ -37,6 +50,22 @@ TcpServer::~TcpServer() {
         item.second.reset();
         conn->getLoop()->runInLoop(std::bind(&TcpConnection::connectDestoryed, conn));
     }
+
+    // 分片的Acceptor与连接只能在各自的subLoop中销毁，等待销毁完成后才能继续析构
+    for(auto& item : shards_) {
+        Shard* shard = item.get();
+        if(shard->loop->isInLoopThread()) {
+            stopShard(shard);
+        }
+        else {
+            std::promise<void> done;
+            shard->loop->runInLoop([this, shard, &done]() {
+                stopShard(shard);
+                done.set_value();
+            });
+            done.get_future().wait();
+        }
+    }
 }
 
 void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr) {
@@ -49,29 +78,52 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr) {
     LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s \n",
         name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
 
-    sockaddr_in local;
-    bzero(&local, sizeof(local));
-    socklen_t addrlen = sizeof(local);
-    if(::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0) {
-        LOG_ERROR("sockets::getLocalAddr");
+    TcpConnectionPtr conn = createConnection(ioLoop, connName, sockfd, peerAddr);
+    connections_[connName] = conn;
+
+    // 设置了关闭连接的回调
+    conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
+
+    // 先按subLoop暂存，这一批accept完之后在flushNewConnections中统一交给subLoop
+    pendingConnections_[ioLoop].push_back(conn);
+}
+
+void TcpServer::flushNewConnections() {
+    for(auto& item : pendingConnections_) {
+        if(item.second.empty()) {
+            continue;
+        }
+        // 调用TcpConnection::connectEstablished，将socket放入这个Conn管理的channel并放入对应的Loop与Poller中
+        // 一个subLoop的整批连接只投递一个回调
+        std::vector<TcpConnectionPtr> conns;
+        conns.swap(item.second);
+        item.first->runInLoop(std::bind(&establishConnections, std::move(conns)));
     }
+}
 
-    InetAddress localAddr(local);
+TcpConnectionPtr TcpServer::createConnection(EventLoop* ioLoop, const std::string& connName,
+                                             int sockfd, const InetAddress& peerAddr) {
+    InetAddress localAddr(listenAddr_);
+    if(!listenAddrSpecific_) {
+        // 监听的是INADDR_ANY或者随机端口，需要通过getsockname获取连接实际的本地地址
+        sockaddr_in local;
+        bzero(&local, sizeof(local));
+        socklen_t addrlen = sizeof(local);
+        if(::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0) {
+            LOG_ERROR("sockets::getLocalAddr");
+        }
+        localAddr.setSockAddr(local);
+    }
 
     // 根据连接成功的sockfd创建TcpConnection对象
     TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
-    connections_[connName] = conn;
 
     // 下面的回调都是用户设置的
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
-
-    // 设置了关闭连接的回调
-    conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
-
-    // 直接调用TcpConnection::connectEstablished，将socket放入这个Conn管理的channel并放入对应的Loop与Poller中
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    conn->setEdgeTriggered(edgeTriggered_);
+    return conn;
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr &conn) {
@@ -86,6 +138,10 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn) {
     ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestoryed, conn));
 }
 
+void TcpServer::setAcceptBatch(int batch) {
+    acceptBatch_ = batch;   // start时设置给创建的Acceptor
+}
+
 void TcpServer::setThreadNum(int numThreads) {
     threadPool_->setThreadNum(numThreads);
 }
@@ -94,7 +150,76 @@ void TcpServer::setThreadNum(int numThreads) {
 void TcpServer::start() {
     if(started_ ++ == 0) {   // 防止多次启动
         threadPool_->start(threadInitCallback_);
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        if(busyPollUs_ > 0) {
+            for(EventLoop* ioLoop : threadPool_->getAllLoops()) {
+                ioLoop->setBusyPoll(busyPollUs_);
+            }
+        }
+        std::vector<EventLoop*> ioLoops = threadPool_->getAllLoops();
+        if(option_ == kReusePort && ioLoops.front() != loop_) {
+            // 有subLoop时每个subLoop自己监听，MainLoop不创建acceptor_，不会多绑定一个不listen的socket
+            startShards();
+        }
+        else {
+            // 是否分片要等到setThreadNum之后才能确定，所以acceptor_在这里才创建并bind
+            acceptor_.reset(new Acceptor(loop_, listenAddr_, option_ == kReusePort));
+            acceptor_->setAcceptBatch(acceptBatch_);
+            acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
+                                                std::placeholders::_1, std::placeholders::_2));
+            acceptor_->setBatchEndCallback(std::bind(&TcpServer::flushNewConnections, this));
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        }
+    }
+}
+
+void TcpServer::startShards() {
+    std::vector<EventLoop*> ioLoops = threadPool_->getAllLoops();
+    for(size_t i = 0; i < ioLoops.size(); i++) {
+        Shard* shard = new Shard;
+        shard->index = static_cast<int>(i);
+        shard->loop = ioLoops[i];
+        shard->nextConnId = 1;
+        // 同一个端口绑定多个SO_REUSEPORT的socket，由内核把新连接分散到各个socket上
+        shard->acceptor.reset(new Acceptor(shard->loop, listenAddr_, true));
+        shard->acceptor->setAcceptBatch(acceptBatch_);
+        shard->acceptor->setNewConnectionCallback(std::bind(&TcpServer::newShardConnection, this,
+                                                  shard, std::placeholders::_1, std::placeholders::_2));
+        shards_.push_back(std::unique_ptr<Shard>(shard));
+        shard->loop->runInLoop(std::bind(&Acceptor::listen, shard->acceptor.get()));
+    }
+}
+
+void TcpServer::newShardConnection(Shard* shard, int sockfd, const InetAddress& peerAddr) {
+    std::string buf;
+    buf = "-" + ipPort_ + "#" + std::to_string(shard->index) + "-" + std::to_string(shard->nextConnId);
+    shard->nextConnId++;
+    std::string connName = name_ + buf;
+
+    LOG_INFO("TcpServer::newShardConnection [%s] - new connection [%s] from %s \n",
+        name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
+
+    TcpConnectionPtr conn = createConnection(shard->loop, connName, sockfd, peerAddr);
+    shard->connections[connName] = conn;
+    conn->setCloseCallback(std::bind(&TcpServer::removeShardConnection, this, shard, std::placeholders::_1));
+
+    // 已经在连接所属的loop线程中，直接建立连接
+    conn->connectEstablished();
+}
+
+void TcpServer::removeShardConnection(Shard* shard, const TcpConnectionPtr &conn) {
+    LOG_INFO("TcpServer::removeShardConnection [%s] - connection %s \n", name_.c_str(), conn->name().c_str());
+
+    shard->connections.erase(conn->name());
+    shard->loop->queueInLoop(std::bind(&TcpConnection::connectDestoryed, conn));
+}
+
+void TcpServer::stopShard(Shard* shard) {
+    shard->acceptor.reset();
+    for(auto& item : shard->connections) {
+        TcpConnectionPtr conn(item.second);
+        item.second.reset();
+        conn->connectDestoryed();
     }
+    shard->connections.clear();
 }
 
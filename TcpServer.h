@@ -20,6 +20,7 @@
 #include <atomic>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 
 class TcpServer : noncopyable {
@@ -29,7 +30,7 @@ public:
 
     enum Option {
         kNoReusePort, 
-        kReusePort,
+        kReusePort,     // 多线程时每个subLoop各自持有一个SO_REUSEPORT的Acceptor，在本线程accept并创建连接
     };
 
     TcpServer(EventLoop* loop, const InetAddress& listenAddr, 
@@ -42,21 +43,54 @@ public:
     void setWriteCompleteCallback(const WriteCompleteCallback& cb) { writeCompleteCallback_ = cb; }
 
     void setThreadNum(int numThreads);
+    // 新连接使用边沿触发模式，一次注册IN|OUT|RDHUP，读写兴趣变化不再调用epoll_ctl，需要在start之前调用
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    // 设置Acceptor每次可读事件最多accept的连接数，需要在start之前调用
+    void setAcceptBatch(int batch);
+    // 获取线程池，可以通过getAllStats、getAllBufferPoolStats读取各个loop的运行统计和缓冲区内存占用
+    std::shared_ptr<EventLoopThreadPool> threadPool() const { return threadPool_; }
+    // 为所有处理连接读写的loop开启自旋轮询，详见EventLoop::setBusyPoll，需要在start之前调用
+    void setBusyPoll(int maxSpinUs) { busyPollUs_ = maxSpinUs; }
 
     // 开启服务器监听，相当于开启MainLoop的Acceptor的listen
     void start();
 private:
+    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+
+    // kReusePort模式下每个subLoop对应一个分片，分片内的成员只在该subLoop线程中访问
+    struct Shard {
+        int index;
+        EventLoop* loop;
+        std::unique_ptr<Acceptor> acceptor;
+        int nextConnId;
+        ConnectionMap connections;
+    };
+
     // 向subLoop中分发channel就是调用这个函数，acceptor中跑的就是这个
     void newConnection(int sockfd, const InetAddress& peerAddr);
     void removeConnection(const TcpConnectionPtr &conn);
     void removeConnectionInLoop(const TcpConnectionPtr &conn);
+    // Acceptor一批连接accept完后调用，每个subLoop只投递一个回调并只唤醒一次
+    void flushNewConnections();
 
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    // 创建TcpConnection并设置用户回调，关闭回调由调用者设置
+    TcpConnectionPtr createConnection(EventLoop* ioLoop, const std::string& connName,
+                                      int sockfd, const InetAddress& peerAddr);
+
+    // kReusePort模式，在每个subLoop中创建Acceptor并开始监听
+    void startShards();
+    // 运行在分片的subLoop中，直接在本线程创建连接，没有跨线程投递
+    void newShardConnection(Shard* shard, int sockfd, const InetAddress& peerAddr);
+    void removeShardConnection(Shard* shard, const TcpConnectionPtr &conn);
+    // 运行在分片的subLoop中，关闭Acceptor并销毁所有连接
+    void stopShard(Shard* shard);
 
     EventLoop* loop_;   // 用户自己定义的Loop，就是MainLoop
+    const InetAddress listenAddr_;
     const std::string ipPort_;
     const std::string name_;
-    std::unique_ptr<Acceptor> acceptor_;
+    const Option option_;
+    std::unique_ptr<Acceptor> acceptor_;               // MainLoop的Acceptor，start时创建，kReusePort分片模式下为空
     std::shared_ptr<EventLoopThreadPool> threadPool_;   // one loop per thread
 
     ConnectionCallback connectionCallback_;             // 有新连接时的回调
@@ -66,9 +100,16 @@ private:
     ThreadInitCallback threadInitCallback_;             // Loop线程初始化回调
 
     std::atomic<int> started_;
+    int busyPollUs_;                                    // 自旋轮询时间上限，0表示不开启
+    bool edgeTriggered_;                                // 新连接是否使用边沿触发模式
+    int acceptBatch_;                                   // Acceptor每次可读事件最多accept的连接数
 
     int nextConnId_;
     ConnectionMap connections_;                         // 保存所有的连接
+    // 本批accept的、等待交给subLoop建立的连接，按subLoop分组，只在MainLoop中访问
+    std::unordered_map<EventLoop*, std::vector<TcpConnectionPtr>> pendingConnections_;
+    bool listenAddrSpecific_;                           // 监听地址是否为具体的IP与端口，是则连接的本地地址就是监听地址
+    std::vector<std::unique_ptr<Shard>> shards_;        // kReusePort模式下的分片，连接保存在各自分片中
 };
 
 #endif
\ No newline at end of file
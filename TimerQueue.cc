@@ -0,0 +1,173 @@
+#include "TimerQueue.h"
+#include "Timer.h"
+#include "TimerId.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <algorithm>
+#include <iterator>
+
+// 创建timerfd，使用单调时钟，不受系统时间调整影响
+static int createTimerfd() {
+    int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(timerfd < 0) {
+        LOG_FATAL("timerfd_create error: %d\n", errno);
+    }
+    return timerfd;
+}
+
+// 计算现在到when(单调时钟)还有多长时间，转化为timerfd_settime需要的timespec
+static timespec howMuchTimeFromNow(Timestamp when) {
+    int64_t microseconds = when.microSecondsSinceEpoch()
+                         - Timestamp::monotonic().microSecondsSinceEpoch();
+    if(microseconds < 100) {
+        microseconds = 100;     // 不能设置为0，0表示关闭timerfd
+    }
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
+    ts.tv_nsec = static_cast<long>((microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+    return ts;
+}
+
+// timerfd可读后必须读走，否则水平触发模式下会一直通知
+static void readTimerfd(int timerfd) {
+    uint64_t howmany;
+    ssize_t n = ::read(timerfd, &howmany, sizeof(howmany));
+    if(n != sizeof howmany) {
+        LOG_ERROR("TimerQueue::handleRead() reads %ld bytes instead of 8\n", n);
+    }
+}
+
+// 重新设置timerfd的超时时间为expiration
+static void resetTimerfd(int timerfd, Timestamp expiration) {
+    itimerspec newValue;
+    itimerspec oldValue;
+    memset(&newValue, 0, sizeof(newValue));
+    memset(&oldValue, 0, sizeof(oldValue));
+    newValue.it_value = howMuchTimeFromNow(expiration);
+    if(::timerfd_settime(timerfd, 0, &newValue, &oldValue) < 0) {
+        LOG_ERROR("timerfd_settime error: %d\n", errno);
+    }
+}
+
+TimerQueue::TimerQueue(EventLoop* loop)
+    : loop_(loop)
+    , timerfd_(createTimerfd())
+    , timerfdChannel_(loop, timerfd_)
+    , timers_()
+    , callingExpiredTimers_(false)
+{
+    timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
+    timerfdChannel_.enableReading();
+}
+
+TimerQueue::~TimerQueue() {
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
+    ::close(timerfd_);
+    for(const Entry& timer : timers_) {
+        delete timer.second;
+    }
+}
+
+TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval) {
+    Timer* timer = new Timer(std::move(cb), when, interval);
+    loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
+    return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::cancel(TimerId timerId) {
+    loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(Timer* timer) {
+    bool earliestChanged = insert(timer);
+    if(earliestChanged) {
+        // 新的定时器最早到期，需要重新设置timerfd
+        resetTimerfd(timerfd_, timer->expiration());
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId) {
+    ActiveTimer timer(timerId.timer_, timerId.sequence_);
+    auto it = activeTimers_.find(timer);
+    if(it != activeTimers_.end()) {
+        timers_.erase(Entry(it->first->expiration(), it->first));
+        delete it->first;
+        activeTimers_.erase(it);
+    }
+    else if(callingExpiredTimers_) {
+        // 定时器已经到期被取出，正在执行回调(可能是在自己的回调里取消自己)
+        // 记录下来，reset时不再重新加入队列
+        cancelingTimers_.insert(timer);
+    }
+}
+
+void TimerQueue::handleRead() {
+    Timestamp now(Timestamp::monotonic());
+    readTimerfd(timerfd_);
+
+    // 一次取出所有到期的定时器，在本轮loop中批量执行
+    std::vector<Entry> expired = getExpired(now);
+
+    callingExpiredTimers_ = true;
+    cancelingTimers_.clear();
+    for(const Entry& it : expired) {
+        it.second->run();
+    }
+    callingExpiredTimers_ = false;
+
+    reset(expired, now);
+}
+
+std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now) {
+    std::vector<Entry> expired;
+    // 哨兵，超时时间相同时比所有Timer*都大，lower_bound返回第一个未到期的定时器
+    Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
+    auto end = timers_.lower_bound(sentry);
+    std::copy(timers_.begin(), end, std::back_inserter(expired));
+    timers_.erase(timers_.begin(), end);
+
+    for(const Entry& it : expired) {
+        ActiveTimer timer(it.second, it.second->sequence());
+        activeTimers_.erase(timer);
+    }
+    return expired;
+}
+
+void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now) {
+    for(const Entry& it : expired) {
+        ActiveTimer timer(it.second, it.second->sequence());
+        if(it.second->repeat() && cancelingTimers_.find(timer) == cancelingTimers_.end()) {
+            it.second->restart(now);
+            insert(it.second);
+        }
+        else {
+            delete it.second;
+        }
+    }
+
+    if(!timers_.empty()) {
+        Timestamp nextExpire = timers_.begin()->second->expiration();
+        if(nextExpire.valid()) {
+            resetTimerfd(timerfd_, nextExpire);
+        }
+    }
+}
+
+bool TimerQueue::insert(Timer* timer) {
+    bool earliestChanged = false;
+    Timestamp when = timer->expiration();
+    auto it = timers_.begin();
+    if(it == timers_.end() || when < it->first) {
+        earliestChanged = true;
+    }
+    timers_.insert(Entry(when, timer));
+    activeTimers_.insert(ActiveTimer(timer, timer->sequence()));
+    return earliestChanged;
+}
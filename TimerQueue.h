@@ -0,0 +1,59 @@
+#ifndef __TIMERQUEUE_H__
+#define __TIMERQUEUE_H__
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+#include "Channel.h"
+#include <set>
+#include <vector>
+
+class EventLoop;
+class Timer;
+class TimerId;
+
+/**
+ * 定时器队列，每个EventLoop持有一个
+ * 内部使用timerfd，timerfd封装为Channel注册到loop的Poller中，与其他fd一样由epoll_wait统一等待
+ * timerfd只设置为最早到期的定时器的超时时间，可读时批量处理所有已经到期的定时器
+ * 定时器使用std::set按照(超时时间, Timer*)排序，插入与删除都为O(log n)
+*/
+class TimerQueue : noncopyable {
+public:
+    explicit TimerQueue(EventLoop* loop);
+    ~TimerQueue();
+
+    // 添加定时器，线程安全，可以在其他线程中调用
+    // when是单调时钟(Timestamp::monotonic)上的时间点，调整系统时间不影响定时器
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    // 取消定时器，线程安全，可以在其他线程中调用
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer* timer);
+    void cancelInLoop(TimerId timerId);
+    // timerfd可读时的回调
+    void handleRead();
+    // 取出所有已经超时的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    // 重复定时器重新加入队列，其余的定时器删除
+    void reset(const std::vector<Entry>& expired, Timestamp now);
+    // 插入定时器，返回最早到期的定时器是否发生了改变
+    bool insert(Timer* timer);
+
+    EventLoop* loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    TimerList timers_;      // 按超时时间排序的定时器
+
+    ActiveTimerSet activeTimers_;           // 按Timer*排序，与timers_保存的是同一批定时器，用于cancel
+    bool callingExpiredTimers_;             // 是否正在执行超时回调
+    ActiveTimerSet cancelingTimers_;        // 执行超时回调期间被取消的定时器，不再重新加入队列
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "Timestamp.h"
 #include <time.h>
+#include <stdio.h>
+#include <string.h>
 
 Timestamp::Timestamp() {
     microSecondsSinceEpoch_ = 0;
@@ -9,22 +11,66 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch) {
     microSecondsSinceEpoch_ = microSecondsSinceEpoch;
 }
 
+// 定时器和接收时间需要微秒精度，clock_gettime走vDSO，不陷入内核
 Timestamp Timestamp::now() {
-    time_t ti = time(NULL);
-    return Timestamp(ti);
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    int64_t seconds = ts.tv_sec;
+    return Timestamp(seconds * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
+
+Timestamp Timestamp::monotonic() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t seconds = ts.tv_sec;
+    return Timestamp(seconds * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
+
+// 每个线程缓存上一次格式化的秒与结果
+// 按6个int都取最长(11个字符)时的长度分配，正常日期只用前19个字符
+static __thread time_t t_lastSecond = -1;
+static __thread char t_secondBuf[72];
+
+int Timestamp::formatTo(char* buf, bool showMicroseconds) const {
+    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
+    if(seconds != t_lastSecond) {
+        struct tm tm_time;
+        ::localtime_r(&seconds, &tm_time);
+        snprintf(t_secondBuf, sizeof(t_secondBuf), "%4d/%02d/%02d %02d:%02d:%02d",
+            tm_time.tm_year + 1900,
+            tm_time.tm_mon + 1,
+            tm_time.tm_mday,
+            tm_time.tm_hour,
+            tm_time.tm_min,
+            tm_time.tm_sec);
+        t_lastSecond = seconds;
+    }
+    // "yyyy/mm/dd hh:mm:ss"固定19个字符
+    memcpy(buf, t_secondBuf, 19);
+    if(!showMicroseconds) {
+        buf[19] = '\0';
+        return 19;
+    }
+    int microseconds = static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond);
+    buf[19] = '.';
+    for(int i = 25; i >= 20; i--) {
+        buf[i] = static_cast<char>('0' + microseconds % 10);
+        microseconds /= 10;
+    }
+    buf[26] = '\0';
+    return kFormattedLength;
 }
 
 std::string Timestamp::toString() const {
-    char buf[128];
-    tm* tm_time = localtime(&microSecondsSinceEpoch_);
-    snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d", 
-        tm_time->tm_year + 1900,
-        tm_time->tm_mon + 1, 
-        tm_time->tm_mday,
-        tm_time->tm_hour,
-        tm_time->tm_min,
-        tm_time->tm_sec);
-    return buf;
+    char buf[32];
+    int len = formatTo(buf, false);
+    return std::string(buf, len);
+}
+
+std::string Timestamp::toFormattedString(bool showMicroseconds) const {
+    char buf[32];
+    int len = formatTo(buf, showMicroseconds);
+    return std::string(buf, len);
 }
 
 // #include <iostream>
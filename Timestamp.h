@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <string>
+#include <stdint.h>
 
 class Timestamp {
 public:
@@ -10,13 +11,48 @@ public:
     Timestamp();
     //
     explicit Timestamp(int64_t );   // 禁止隐式转换
-    // 获取当前时间戳，配合toString使用
+    // 获取当前时间戳(CLOCK_REALTIME，微秒精度)，用于显示、接收时间和定时器
     static Timestamp now();
-    // 将时间戳转化为字符串
+    // 单调时钟(CLOCK_MONOTONIC)，不受系统时间调整影响，只用于计算时间间隔，不能与now()混用
+    static Timestamp monotonic();
+    // 无效时间戳，microSecondsSinceEpoch_为0
+    static Timestamp invalid() { return Timestamp(); }
+    // 将时间戳转化为字符串 2026/10/18 01:23:45
     std::string toString() const;
+    // 带微秒的字符串 2026/10/18 01:23:45.123456
+    std::string toFormattedString(bool showMicroseconds = true) const;
+    // 写入buf，返回写入的长度，buf至少kFormattedLength+1字节
+    // 每个线程缓存上一次格式化的秒，同一秒内只需要重新格式化微秒部分
+    int formatTo(char* buf, bool showMicroseconds = true) const;
+
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
+    static const int kFormattedLength = 26;     // 带微秒时的长度
 private:
     int64_t microSecondsSinceEpoch_;
 };
 
+inline bool operator<(Timestamp lhs, Timestamp rhs) {
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs) {
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+// 时间戳加上seconds秒，定时器计算超时时间使用
+inline Timestamp addTime(Timestamp timestamp, double seconds) {
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
+
+// 两个时间戳的差值，单位为秒
+inline double timeDifference(Timestamp high, Timestamp low) {
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
 #endif
 
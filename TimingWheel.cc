@@ -0,0 +1,132 @@
+#include "TimingWheel.h"
+#include "EventLoop.h"
+
+#include <math.h>
+
+const double TimingWheel::kDefaultTick = 1.0;
+
+TimingWheel::TimingWheel(EventLoop* loop, double tick, size_t numBuckets)
+    : loop_(loop)
+    , tick_(tick)
+    , numBuckets_(numBuckets)
+    , buckets_(new Node[numBuckets])
+    , cursor_(0)
+    , size_(0)
+    , ticking_(false)
+{
+    for(size_t i = 0; i < numBuckets_; i++) {
+        buckets_[i].prev_ = &buckets_[i];
+        buckets_[i].next_ = &buckets_[i];
+    }
+}
+
+TimingWheel::~TimingWheel() {
+    if(ticking_) {
+        loop_->cancel(tickTimer_);
+    }
+    // 摘下所有节点，节点的持有者可能比时间轮活得更久
+    for(size_t i = 0; i < numBuckets_; i++) {
+        Node* head = &buckets_[i];
+        while(head->next_ != head) {
+            Node* node = head->next_;
+            node->unlink();
+            node->wheel_ = nullptr;
+        }
+        head->prev_ = nullptr;
+        head->next_ = nullptr;
+    }
+}
+
+void TimingWheel::schedule(Node* node, double timeout) {
+    // 至少一个tick，不足一个tick的部分向上取整
+    size_t ticks = static_cast<size_t>(ceil(timeout / tick_));
+    if(ticks == 0) {
+        ticks = 1;
+    }
+    if(ticking_) {
+        // 当前这一格已经过去了一部分，下一次tick可能马上就到，多等一格才不会提前超时
+        // 定时器还没启动时，它会在tick秒后第一次触发，不需要补这一格
+        ticks++;
+    }
+    size_t slot = (cursor_ + ticks) % numBuckets_;
+    size_t rounds = (ticks - 1) / numBuckets_;
+
+    if(node->linked()) {
+        if(node->slot_ == slot && node->rounds_ == rounds) {
+            return;     // 同一个tick内反复touch，位置没有变化
+        }
+        node->unlink();
+        size_--;
+    }
+    node->rounds_ = rounds;
+    link(node, slot);
+
+    if(!ticking_) {
+        ticking_ = true;
+        tickTimer_ = loop_->runEvery(tick_, std::bind(&TimingWheel::onTick, this));
+    }
+}
+
+void TimingWheel::cancel(Node* node) {
+    if(node->linked()) {
+        node->unlink();
+        node->wheel_ = nullptr;
+        size_--;
+    }
+}
+
+void TimingWheel::link(Node* node, size_t slot) {
+    Node* head = &buckets_[slot];
+    node->wheel_ = this;
+    node->slot_ = slot;
+    node->prev_ = head->prev_;
+    node->next_ = head;
+    head->prev_->next_ = node;
+    head->prev_ = node;
+    size_++;
+}
+
+void TimingWheel::onTick() {
+    cursor_ = (cursor_ + 1) % numBuckets_;
+    Node* head = &buckets_[cursor_];
+
+    // 先把到期的节点转移到局部链表中，回调里可能会cancel或者schedule其他节点
+    Node expired;
+    expired.prev_ = &expired;
+    expired.next_ = &expired;
+
+    Node* node = head->next_;
+    while(node != head) {
+        Node* next = node->next_;
+        if(node->rounds_ == 0) {
+            node->unlink();
+            node->prev_ = expired.prev_;
+            node->next_ = &expired;
+            expired.prev_->next_ = node;
+            expired.prev_ = node;
+        }
+        else {
+            node->rounds_--;
+        }
+        node = next;
+    }
+
+    while(expired.next_ != &expired) {
+        Node* timeout = expired.next_;
+        timeout->unlink();
+        timeout->wheel_ = nullptr;
+        size_--;
+        if(timeout->callback_) {
+            timeout->callback_();   // 回调中节点可能被析构，之后不能再访问
+        }
+    }
+    expired.prev_ = nullptr;
+    expired.next_ = nullptr;
+
+    if(size_ == 0 && ticking_) {
+        // 时间轮空了，停掉定时器，下一次schedule时重新启动
+        // 不在cancel中立即停止，避免连接频繁建立、关闭时反复创建定时器
+        loop_->cancel(tickTimer_);
+        ticking_ = false;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef __TIMINGWHEEL_H__
+#define __TIMINGWHEEL_H__
+
+#include "noncopyable.h"
+#include "TimerId.h"
+#include <functional>
+#include <memory>
+
+class EventLoop;
+
+/**
+ * 哈希时间轮，每个EventLoop持有一个，用于大量连接的空闲超时与写超时
+ * 时间轮由numBuckets个槽组成，每tick秒前进一格，借助TimerQueue的runEvery驱动
+ * 每个槽是一个侵入式双向链表，超时时间超过一圈的节点用rounds_记录剩余圈数
+ * 插入、touch(重新调度)、取消都是O(1)，不需要为每个连接单独创建Timer
+ * 超时时间向上取整到tick，回调只会晚于、不会早于设定的时间，最多晚一个tick
+ * 时间轮上没有节点时停掉驱动它的定时器，空闲的loop不会每秒被唤醒
+ * 所有接口都只能在loop线程中调用
+*/
+class TimingWheel : noncopyable {
+public:
+    using ExpireCallback = std::function<void()>;
+
+    // 挂在时间轮上的节点，由使用者持有(例如嵌入在TcpConnection中)
+    class Node : noncopyable {
+    public:
+        Node()
+            : prev_(nullptr)
+            , next_(nullptr)
+            , wheel_(nullptr)
+            , slot_(0)
+            , rounds_(0)
+        {}
+        // 还挂在时间轮上时通过cancel摘下，保证时间轮的节点计数正确
+        ~Node() {
+            if(wheel_ != nullptr) {
+                wheel_->cancel(this);
+            }
+        }
+
+        // 设置超时回调，在loop线程中执行，执行前节点已经从时间轮上摘下
+        void setCallback(ExpireCallback cb) { callback_ = std::move(cb); }
+        bool linked() const { return prev_ != nullptr; }
+
+    private:
+        friend class TimingWheel;
+
+        void unlink() {
+            if(prev_) {
+                prev_->next_ = next_;
+                next_->prev_ = prev_;
+                prev_ = nullptr;
+                next_ = nullptr;
+            }
+        }
+
+        Node* prev_;
+        Node* next_;
+        TimingWheel* wheel_;    // 所在的时间轮，不在时间轮上时为空
+        size_t slot_;       // 所在的槽
+        size_t rounds_;     // 还需要转几圈才超时
+        ExpireCallback callback_;
+    };
+
+    static const size_t kDefaultBuckets = 512;
+    static const double kDefaultTick;   // 1秒
+
+    TimingWheel(EventLoop* loop, double tick = kDefaultTick, size_t numBuckets = kDefaultBuckets);
+    ~TimingWheel();
+
+    // timeout秒后执行node的回调，node已经在时间轮上时相当于touch，重新计算超时时间
+    void schedule(Node* node, double timeout);
+    // 将node从时间轮上摘下，不再执行回调
+    void cancel(Node* node);
+
+    // 时间轮上的节点个数
+    size_t size() const { return size_; }
+
+private:
+    // 时间轮前进一格，处理当前槽中到期的节点
+    void onTick();
+    // 把node插入到slot槽的链表尾部
+    void link(Node* node, size_t slot);
+
+    EventLoop* loop_;
+    const double tick_;
+    const size_t numBuckets_;
+    std::unique_ptr<Node[]> buckets_;   // 每个槽的哨兵节点，链表为环形
+    size_t cursor_;                     // 最近一次tick处理的槽
+    size_t size_;
+    bool ticking_;                      // 驱动时间轮的定时器是否在运行
+    TimerId tickTimer_;
+};
+
+#endif
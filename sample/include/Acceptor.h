@@ -13,22 +13,38 @@ class InetAddress;
 class Acceptor : noncopyable {
 public:
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress&)>;
+    // 一次可读事件中的所有连接都accept完之后调用
+    using BatchEndCallback = std::function<void()>;
     Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport);
     ~Acceptor();
 
     void setNewConnectionCallback(const NewConnectionCallback& cb) { newConnectionCallback_ = cb; }
+    void setBatchEndCallback(const BatchEndCallback& cb) { batchEndCallback_ = cb; }
+    // 每次可读事件最多accept的连接数
+    void setAcceptBatch(int batch) { acceptBatch_ = batch > 0 ? batch : 1; }
 
     bool listenning() const { return listenning_; }
     void listen();
 
+    static const int kDefaultAcceptBatch = 64;
+
 private:
     void headleRead();
+    // fd耗尽时释放预留的idleFd_，accept之后立即关闭，让客户端收到断开而不是一直留在backlog中
+    void dropConnection();
+    // 限制accept错误日志的频率，每秒最多输出一次
+    void logAcceptError(int err);
 
     EventLoop* loop_;   // 用户定义的MainLoop
     Socket acceptSocket_;
     Channel acceptChannel_;
     NewConnectionCallback newConnectionCallback_;
+    BatchEndCallback batchEndCallback_;
     bool listenning_;
+    int acceptBatch_;
+    int idleFd_;                // 预留的空闲fd，EMFILE时使用
+    Timestamp lastErrorLog_;    // 上一次输出accept错误日志的时间
+    int suppressedErrors_;      // 距上一次输出被忽略的错误次数
 };
 
 #endif // #ifndef __ACCEPTOR_H__
@@ -0,0 +1,83 @@
+#ifndef __BUFFERPOOL_H__
+#define __BUFFERPOOL_H__
+
+#include "noncopyable.h"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ Buffer存储空间的内存池，每个EventLoop一个
+ 按2的幂划分大小级别(256B ~ 1MB)，每个级别一个空闲链表，空闲块不够时从2MB的slab中切分
+ slab用mmap申请，可选使用大页；超过最大级别的请求直接malloc，不进池
+ 只应在所属loop线程中分配；其他线程释放(例如连接在别的线程析构)时先放进remoteFrees_，由loop线程下次分配时回收
+*/
+class BufferPool : noncopyable {
+public:
+    static const size_t kMinChunkShift = 8;     // 256B
+    static const size_t kMaxChunkShift = 20;    // 1MB
+    static const int kNumClasses = kMaxChunkShift - kMinChunkShift + 1;
+    static const size_t kSlabSize = 2*1024*1024;
+
+    // 占用情况，可以在任意线程中获取
+    struct Snapshot {
+        size_t chunkSize[kNumClasses];
+        size_t inUse[kNumClasses];      // 分配出去的块数
+        size_t free[kNumClasses];       // 空闲链表中的块数
+        size_t remoteFrees;             // 其他线程归还、loop线程还没有回收的块数
+        size_t slabBytes;               // 从系统申请的slab总字节数
+        size_t largeBytes;              // 超过最大级别、直接malloc的字节数
+        bool hugePages;                 // slab是否使用了大页
+        std::string toString() const;
+    };
+
+    explicit BufferPool(bool useHugePages = false);
+    ~BufferPool();
+
+    // 分配至少size字节，实际大小写入*capacity
+    char* allocate(size_t size, size_t* capacity);
+    // capacity必须是allocate返回的大小
+    void deallocate(char* p, size_t capacity);
+
+    Snapshot snapshot() const;
+
+private:
+    struct FreeChunk {
+        FreeChunk* next;
+    };
+
+    struct SizeClass {
+        SizeClass() : freeList(nullptr), inUse(0), free(0) {}
+        FreeChunk* freeList;
+        std::atomic<size_t> inUse;
+        std::atomic<size_t> free;
+    };
+
+    static int classIndex(size_t size);
+
+    char* allocateFromSlab(size_t chunkSize);
+    // 放回空闲链表，只在loop线程中调用
+    void pushFree(char* p, size_t capacity);
+    void drainRemoteFrees();
+
+    const pid_t ownerThread_;
+    const bool useHugePages_;
+    std::atomic<bool> hugePagesActive_;
+    SizeClass classes_[kNumClasses];
+
+    std::vector<char*> slabs_;
+    char* slabCur_;         // 当前slab中还没有切分过的部分
+    char* slabEnd_;
+    std::atomic<size_t> slabBytes_;
+    std::atomic<size_t> largeBytes_;
+
+    std::mutex remoteMutex_;
+    std::vector<std::pair<char*, size_t>> remoteFrees_;
+    std::atomic<size_t> numRemoteFrees_;
+};
+
+#endif
@@ -16,4 +16,6 @@ using WriteCompleteCallback = std::function<void(const TcpConnectionPtr&)>;
 using MessageCallback = std::function<void(const TcpConnectionPtr&, Buffer*, Timestamp)>;
 using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr&, size_t)>;
 
+using TimerCallback = std::function<void()>;
+
 #endif
\ No newline at end of file
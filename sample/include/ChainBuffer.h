@@ -0,0 +1,88 @@
+#ifndef __CHAINBUFFER_H__
+#define __CHAINBUFFER_H__
+
+#include "noncopyable.h"
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+class BufferPool;
+
+/*
+ TcpConnection的输出缓冲区，由若干片段串成
+ 片段有三种：从BufferPool分配的定长块，引用外部数据的切片(持有owner的引用计数，不拷贝)，
+ 以及文件区间(用sendfile直接从page cache发送，不经过用户态)
+ 追加数据只会写进最后一个块的剩余空间或者新的块，不会像连续的Buffer那样扩容、整体搬移
+ writeFd用writev一次最多发出IOV_MAX个内存片段，遇到文件区间时单独用sendfile发送，保证先后顺序
+ 打开MSG_ZEROCOPY时，足够大的外部切片用sendmsg(MSG_ZEROCOPY)发送，内核直接引用用户内存，
+ 这样的切片发送完后owner还要保留到错误队列上收到对应的完成通知(zeroCopyCompleted)
+ 只在所属loop线程中使用
+*/
+class ChainBuffer : noncopyable {
+public:
+    static const size_t kBlockSize = 16*1024;
+    static const size_t kMinSliceSize = 1024;   // 比这短的共享数据直接拷贝，引用计数不划算
+
+    explicit ChainBuffer(BufferPool* pool = nullptr);
+    ~ChainBuffer();
+
+    size_t readableBytes() const { return readable_; }
+    size_t numSegments() const { return segments_.size() - head_; }
+
+    // 拷贝data到缓冲区末尾
+    void append(const char* data, size_t len);
+    // 追加一段外部数据，在数据发送完之前持有owner
+    void appendShared(const std::shared_ptr<const void>& owner, const char* data, size_t len);
+    // 追加文件fd中[offset, offset + len)的内容，接管fd，发送完或者丢弃时close
+    void appendFile(int fd, off_t offset, size_t len);
+
+    // 丢弃前len字节，发送完的块还给池
+    void retrieve(size_t len);
+    void retrieveAll();
+
+    // 把缓冲区中的数据写入fd，返回写出的字节数，不会自动retrieve
+    // 文件比登记的区间短时返回-1，*saveErrno为ENODATA
+    // zeroCopyThreshold不为0时，不短于它的外部切片用MSG_ZEROCOPY发送，fd需要已经打开SO_ZEROCOPY
+    ssize_t writeFd(int fd, int* saveErrno, size_t zeroCopyThreshold = 0);
+
+    // 错误队列上收到[lo, hi]这些MSG_ZEROCOPY发送的完成通知，释放对应的切片
+    void zeroCopyCompleted(uint32_t lo, uint32_t hi);
+    // 已经发送、还在等待完成通知的切片个数
+    size_t zeroCopyPending() const { return zeroCopyPending_.size(); }
+    // 丢弃缓冲区中的数据，取出所有还在等待完成通知的切片的owner，由调用者保证内核不再引用后再释放
+    // 连接销毁时使用，ChainBuffer析构时仍在等待的切片会直接释放
+    std::vector<std::shared_ptr<const void>> releaseZeroCopyPending();
+
+private:
+    struct Segment {
+        char* data;
+        size_t capacity;    // 块的大小，外部切片和文件为0，不能再写入
+        size_t begin;       // [begin, end)是还没有发送的数据，文件区间是文件内的偏移
+        size_t end;
+        int fd;             // 文件区间的fd，其他片段为-1
+        bool zeroCopy;      // 是否有部分内容用MSG_ZEROCOPY发送过
+        uint32_t zeroCopyId;    // 最后一次MSG_ZEROCOPY发送的序号
+        std::shared_ptr<const void> owner;
+    };
+
+    ssize_t sendZeroCopy(int fd, Segment& seg, int* saveErrno);
+
+    void releaseSegment(Segment& seg);
+
+    std::vector<Segment> segments_;
+    size_t head_;           // 第一个还有数据的片段，前面的片段都已经释放
+    size_t readable_;
+    BufferPool* pool_;
+
+    // 内核为每次成功的MSG_ZEROCOPY发送依次分配序号，从0开始
+    uint32_t zeroCopyNextId_;
+    uint32_t zeroCopyDoneId_;   // 序号小于它的发送都已经收到完成通知
+    // 已经发送完、等待完成通知的切片，按序号递增
+    std::vector<std::pair<uint32_t, std::shared_ptr<const void>>> zeroCopyPending_;
+};
+
+#endif
@@ -40,6 +40,8 @@ public:
 
     int fd() const { return fd_; }
     int events() const { return events_; }
+    // 注册到poller中的事件，边沿触发模式下只要有兴趣就注册IN|OUT|RDHUP|ET，不随读写兴趣变化
+    int pollEvents() const { return (edgeTriggered_ && events_ != kNoneEvent) ? kEdgeEvents : events_; }
     // epoll检测到事件后设置revents_ 调用该接口，由channel负责执行
     void set_revents(int revt) { revents_ = revt; }
 
@@ -54,6 +56,11 @@ public:
     bool isReading() const { return kReadEvent & events_;}
     bool isWriting() const { return kWriteEvent & events_; }
 
+    // 开启边沿触发模式，需要在第一次enableReading/enableWriting之前调用
+    // 该模式下读写兴趣的变化只记录在events_中，不再调用epoll_ctl，poller返回的事件按兴趣过滤后再回调
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool edgeTriggered() const { return edgeTriggered_; }
+
     int index() const { return index_; }
     void set_index(int idx) { index_ = idx; }
 
@@ -71,12 +78,15 @@ private:
     static const int kNoneEvent;
     static const int kReadEvent;
     static const int kWriteEvent;
+    static const int kEdgeEvents;
 
     EventLoop* loop_;   // 事件循环
     const int fd_;      // poller监听的对象
     int events_;        // 注册fd感兴趣的事件
     int revents_;       // poller返回的具体发生的事件
     int index_;         // 
+    bool edgeTriggered_;    // 是否为边沿触发模式
+    int registeredEvents_;  // 边沿触发模式下最近一次注册到poller的事件，没有变化时不调用epoll_ctl
 
     std::weak_ptr<void> tie_;   // 指向TcpConnection
     bool tied_;
@@ -19,11 +19,12 @@ public:
     virtual Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
     virtual void updateChannel(Channel* channel) override;
     virtual void removeChannel(Channel* channel) override;
+    virtual bool supportsEdgeTriggered() const override { return true; }
 
 private:
     const static int kInitEventListSize = 16;   // EventList的默认长度
     // 将epoll_wait返回的发生事件fd的channel放入activeChannels中，交给eventLoop
-    void fillActiveChannels(int numEvents, ChannelList* activeChannels) const;
+    void fillActiveChannels(int numEvents, ChannelList* activeChannels);
     // 更新channel通道，内部调用epoll_ctl
     void update(int operation, Channel* channel);
 
@@ -0,0 +1,84 @@
+#ifndef __IOURINGPOLLER_H__
+#define __IOURINGPOLLER_H__
+
+#include "Poller.h"
+#include "Channel.h"
+#include <vector>
+#include <stdint.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/*
+ io_uring的使用，直接使用系统调用，不依赖liburing
+ io_uring_setup();  create中调用
+ IORING_OP_POLL_ADD / IORING_OP_POLL_REMOVE  updateChannel中只写入SQ，不进入内核
+ io_uring_enter();  poll中调用，一次系统调用同时提交本轮所有的兴趣变更并等待事件
+
+ 使用单次(oneshot)poll而不是multishot poll:
+ multishot poll只在有新事件时通知，相当于边沿触发，而TcpConnection::handleRead每次只读一次
+ 单次poll在重新提交时会检查当前状态，保持与EPollPoller一致的水平触发语义
+ 重新提交与其他变更一起在下一次io_uring_enter中完成，不增加系统调用次数
+*/
+class IoUringPoller : public Poller {
+public:
+    // 内核不支持(或被禁用)io_uring时返回nullptr，由调用者回退到epoll
+    static IoUringPoller* create(EventLoop* loop);
+    ~IoUringPoller() override;
+
+    virtual Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+    virtual void updateChannel(Channel* channel) override;
+    virtual void removeChannel(Channel* channel) override;
+
+private:
+    const static unsigned kRingEntries = 1024;
+
+    // 每个fd在io_uring中的状态
+    struct PollState {
+        uint32_t seq;       // 注册序号，写入user_data，用于丢弃已经失效的完成事件
+        bool armed;         // 是否有一个poll请求在内核中等待
+    };
+
+    IoUringPoller(EventLoop* loop, int ringfd);
+    // 映射SQ、CQ以及SQE数组，失败返回false
+    bool setupRings(const void* params);
+
+    // 获取一个空闲的SQE，SQ满时先提交
+    io_uring_sqe* getSqe();
+    // 提交SQ中的请求，并等待至少minComplete个完成事件
+    int enter(unsigned minComplete, int timeoutMs);
+    // 为channel提交一个poll请求
+    void arm(Channel* channel, PollState& state);
+    // 取消fd上等待中的poll请求
+    void disarm(int fd, PollState& state);
+    // 处理CQ中的完成事件
+    void fillActiveChannels(ChannelList* activeChannels);
+
+    int ringfd_;
+
+    // SQ
+    void* sqRing_;
+    size_t sqRingSize_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    io_uring_sqe* sqes_;
+    size_t sqesSize_;
+    unsigned sqLocalTail_;      // 已经写入但还没有提交的SQE的尾部
+    unsigned toSubmit_;
+
+    // CQ
+    void* cqRing_;
+    size_t cqRingSize_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe* cqes_;
+
+    uint32_t nextSeq_;
+    std::vector<PollState> states_;     // 以fd为下标，channels_中有这个fd时才有效
+    std::vector<int> rearmFds_;     // 本轮已经触发，需要在下一次enter前重新提交poll的fd
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef __LENGTHHEADERCODEC_H__
+#define __LENGTHHEADERCODEC_H__
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "Timestamp.h"
+
+#include <functional>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ 长度头分帧：每一帧是4字节网络字节序的长度，后面跟着这么多字节的消息体
+ onMessage绑定到TcpServer::setMessageCallback，把收到的字节流切成完整的帧，
+ 每一帧调用一次FrameCallback；data直接指向输入缓冲区，不拷贝，只在回调期间有效
+ 长度为负或者超过maxFrameLength时认为对端协议错误，断开连接
+ 
+ 用法：
+   LengthHeaderCodec codec(onFrame);
+   server.setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec, _1, _2, _3));
+   codec.send(conn, body, len);
+*/
+class LengthHeaderCodec : noncopyable {
+public:
+    using FrameCallback = std::function<void(const TcpConnectionPtr&, const char* data, size_t len, Timestamp)>;
+
+    static const size_t kHeaderLen = sizeof(int32_t);
+    static const size_t kDefaultMaxFrameLength = 64 * 1024 * 1024;
+
+    explicit LengthHeaderCodec(const FrameCallback& cb, size_t maxFrameLength = kDefaultMaxFrameLength);
+
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+
+    // 长度头和消息体作为两段一起交给TcpConnection::send，不需要先拼接
+    // 长度头是int32，len超过INT32_MAX时不发送，输出错误日志
+    void send(const TcpConnectionPtr& conn, const void* data, size_t len);
+    // buf中的全部可读数据作为一帧发送，长度头写在预留的kCheapPrepend区域，发送后buf被清空
+    // 可读数据超过INT32_MAX时不发送，buf保持不变
+    void send(const TcpConnectionPtr& conn, Buffer* buf);
+
+private:
+    FrameCallback frameCallback_;
+    const size_t maxFrameLength_;
+};
+
+#endif
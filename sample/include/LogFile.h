@@ -0,0 +1,48 @@
+#ifndef __LOGFILE_H__
+#define __LOGFILE_H__
+
+#include "noncopyable.h"
+#include <string>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+
+/*
+ 日志文件，只由AsyncLogging的后台线程使用，不加锁
+ 滚动条件：写入字节数超过rollSize，或者跨过了一天
+ 文件名：basename.20261018-012345.hostname.pid.log
+*/
+class LogFile : noncopyable {
+public:
+    LogFile(const std::string& basename, off_t rollSize, int flushInterval = 3, int checkEveryN = 1024);
+    ~LogFile();
+
+    void append(const char* logline, int len);
+    // 把stdio缓冲区写入内核，距离上次fsync超过flushInterval秒时再fsync落盘
+    void flush();
+    // 关闭当前文件并打开一个新文件
+    bool rollFile();
+
+private:
+    static std::string getLogFileName(const std::string& basename, time_t* now);
+    void closeFile();
+
+    static const int kRollPerSeconds = 60*60*24;    // 每天滚动一次
+    static const size_t kFileBufferSize = 64*1024;
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;
+    const int checkEveryN_;
+
+    int count_;                 // 距离上次检查时间的append次数
+    time_t startOfPeriod_;      // 当前文件所属的那一天的起点
+    time_t lastRoll_;
+    time_t lastFlush_;
+    time_t lastSync_;
+    FILE* fp_;
+    off_t writtenBytes_;
+    char buffer_[kFileBufferSize];
+};
+
+#endif
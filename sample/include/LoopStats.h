@@ -0,0 +1,84 @@
+#ifndef __LOOPSTATS_H__
+#define __LOOPSTATS_H__
+
+#include "noncopyable.h"
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * EventLoop的运行统计，每个EventLoop持有一个
+ * 只有loop线程写入(单写者，使用relaxed的load + store，不需要带锁前缀的原子加)
+ * 其他线程可以随时调用snapshot读取，不需要停止loop
+ * 对象前后用填充隔开，避免与EventLoop中其他线程频繁访问的成员伪共享
+*/
+class LoopStats : noncopyable {
+public:
+    static const int kHistogramBuckets = 32;
+
+    // 按2的幂分桶的直方图，第i个桶统计[2^(i-1), 2^i)范围内的值，第0个桶统计0
+    struct HistogramSnapshot {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+        uint64_t buckets[kHistogramBuckets];
+
+        // 近似的分位数，返回所在桶的上界，percentile取值(0, 1]
+        uint64_t percentile(double percentile) const;
+    };
+
+    struct Snapshot {
+        uint64_t iterations;        // loop循环次数
+        uint64_t wakeups;           // 被其他线程通过eventfd唤醒的次数
+        uint64_t epollCtls;         // epoll_ctl调用次数
+        uint64_t functors;          // 执行的pendingFunctors个数
+        HistogramSnapshot pollBlockedUs;    // 每次等待事件(epoll_wait，包括自旋)的耗时，微秒
+        HistogramSnapshot eventsPerPoll;    // 每次poll返回的事件数
+        HistogramSnapshot handleEventUs;    // 每轮执行Channel::handleEvent的总耗时，微秒
+        HistogramSnapshot functorUs;        // 每轮执行doPendingFunctors的耗时，微秒
+    };
+
+    LoopStats();
+
+    void recordPoll(int64_t blockedUs, size_t numEvents);
+    void recordHandleEvent(int64_t us);
+    void recordPendingFunctors(int64_t us, size_t count);
+    void recordWakeup() { increase(wakeups_, 1); }
+    void recordEpollCtl() { increase(epollCtls_, 1); }
+
+    // 线程安全，可以在任意线程调用
+    Snapshot snapshot() const;
+
+private:
+    class Histogram {
+    public:
+        Histogram();
+        void add(uint64_t value);
+        void snapshot(HistogramSnapshot* out) const;
+    private:
+        std::atomic<uint64_t> count_;
+        std::atomic<uint64_t> sum_;
+        std::atomic<uint64_t> max_;
+        std::atomic<uint64_t> buckets_[kHistogramBuckets];
+    };
+
+    static const size_t kCacheLineSize = 64;
+
+    // 单写者计数，读者只会看到新值或者旧值
+    static void increase(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    char pad0_[kCacheLineSize];
+    std::atomic<uint64_t> iterations_;
+    std::atomic<uint64_t> wakeups_;
+    std::atomic<uint64_t> epollCtls_;
+    std::atomic<uint64_t> functors_;
+    Histogram pollBlockedUs_;
+    Histogram eventsPerPoll_;
+    Histogram handleEventUs_;
+    Histogram functorUs_;
+    char pad1_[kCacheLineSize];
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef __MPSCQUEUE_H__
+#define __MPSCQUEUE_H__
+
+#include "noncopyable.h"
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+
+/**
+ * 侵入式无锁多生产者单消费者队列(Vyukov MPSC)，用于EventLoop的pendingFunctors_
+ * 生产者: 任意线程调用push，一次原子exchange完成入队，不加锁
+ * 消费者: 只能是loop线程，调用consume批量取出
+ *
+ * 节点回收: 消费者把用完的节点放回队列的freeList_(只有消费者会push，无ABA问题)
+ * 生产者每次把freeList_整体取走放到自己线程的缓存中，稳定状态下push不需要申请内存
+*/
+template<typename T>
+class MpscQueue : noncopyable {
+public:
+    MpscQueue()
+        : stub_(new Node())
+        , head_(stub_)
+        , tail_(stub_)
+        , freeList_(nullptr)
+    {}
+
+    ~MpscQueue() {
+        deleteChain(tail_);
+        deleteChain(freeList_.load(std::memory_order_acquire));
+    }
+
+    // 任意线程调用
+    void push(T value) {
+        Node* node = allocNode();
+        node->value = std::move(value);
+        node->next.store(nullptr, std::memory_order_relaxed);
+        // 先抢到队尾，再把前一个节点链接过来，两步之间消费者会看到一个断开的链表
+        // seq_cst: EventLoop唤醒合并依赖入队与读取wakeupState_之间的顺序
+        Node* prev = head_.exchange(node, std::memory_order_seq_cst);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 只能由消费者线程调用，依次对调用时已经入队的元素执行func，返回执行的个数
+    // 执行期间新入队的元素留到下一次consume，防止回调中不断入队导致无法退出
+    template<typename Func>
+    size_t consume(Func func) {
+        Node* last = head_.load(std::memory_order_acquire);
+        size_t n = 0;
+        while(tail_ != last) {
+            Node* next = tail_->next.load(std::memory_order_acquire);
+            if(next == nullptr) {
+                // 生产者刚执行完exchange还没有链接上，它入队后会唤醒loop，下一轮再处理
+                break;
+            }
+            T value(std::move(next->value));
+            recycle(tail_);
+            tail_ = next;       // next成为新的哨兵节点
+            func(value);
+            n++;
+        }
+        return n;
+    }
+
+    // 只能由消费者线程调用，生产者exchange之后即视为非空(即使还没有链接上)
+    bool empty() const {
+        return head_.load(std::memory_order_seq_cst) == tail_;
+    }
+
+private:
+    struct Node {
+        Node() : next(nullptr) {}
+        std::atomic<Node*> next;
+        T value;
+    };
+
+    // 生产者线程私有的空闲节点缓存，线程退出时释放
+    struct NodeCache {
+        NodeCache() : head(nullptr) {}
+        ~NodeCache() { deleteChain(head); }
+        Node* head;
+    };
+
+    static Node*& localCache() {
+        static thread_local NodeCache cache;
+        return cache.head;
+    }
+
+    Node* allocNode() {
+        Node*& cache = localCache();
+        if(cache == nullptr) {
+            cache = freeList_.exchange(nullptr, std::memory_order_acquire);
+        }
+        if(cache != nullptr) {
+            Node* node = cache;
+            cache = node->next.load(std::memory_order_relaxed);
+            return node;
+        }
+        return new Node();
+    }
+
+    // 只有消费者调用，单生产者的Treiber栈
+    void recycle(Node* node) {
+        node->value = T();  // 释放回调持有的资源，例如TcpConnectionPtr
+        Node* top = freeList_.load(std::memory_order_relaxed);
+        do {
+            node->next.store(top, std::memory_order_relaxed);
+        } while(!freeList_.compare_exchange_weak(top, node,
+                    std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    static void deleteChain(Node* node) {
+        while(node != nullptr) {
+            Node* next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+
+    static const size_t kCacheLineSize = 64;
+
+    // 生产者与消费者使用的成员用填充隔开放在不同的缓存行，避免伪共享
+    Node* stub_;
+    std::atomic<Node*> head_;   // 最新入队的节点，生产者修改
+    char pad0_[kCacheLineSize];
+    Node* tail_;                // 哨兵节点，tail_->next是队首元素，消费者修改
+    char pad1_[kCacheLineSize];
+    std::atomic<Node*> freeList_;
+};
+
+#endif
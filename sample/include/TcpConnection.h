@@ -5,11 +5,14 @@
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
 #include "Timestamp.h"
+#include "TimingWheel.h"
 
 #include <memory>
 #include <string>
 #include <atomic>
+#include <sys/uio.h>
 
 class Channel;
 class EventLoop;
@@ -58,10 +61,53 @@ public:
         highWaterMarkCallback_ = cb;
     }
 
-    // 发送数据
+    // 发送数据，可以在任意线程调用
+    // 在loop线程中调用时直接写socket，写不完的部分拷贝进输出缓冲区
+    // 在其他线程调用时数据要交给loop线程：const引用和指针版本拷贝一次，右值版本直接移动，不拷贝
     void send(const std::string& buf);
+    void send(std::string&& buf);
+    void send(const void* data, size_t len);
+    // 发送buf中的全部可读数据，调用后buf被清空
+    void send(Buffer* buf);
+    // 把多段数据按顺序发送，在loop线程中调用时一次writev发出，例如header和body不需要先拼接
+    // 在其他线程调用时会先拷贝成一段
+    void send(const struct iovec* iov, int iovcnt);
+    // 用sendfile发送文件fd中[offset, offset + length)的内容，数据不经过用户态
+    // 与之前之后send的数据保持先后顺序，发送完成后调用writeCompleteCallback
+    // 内部会dup一份fd，调用返回后就可以关闭自己的fd，但在发送完之前不要截断文件
+    void sendFile(int fd, off_t offset, size_t length);
+    // 发送共享的数据，不拷贝进输出缓冲区，发送完之前持有payload，期间不能修改其内容
+    // 打开了MSG_ZEROCOPY时，不短于阈值的payload由内核直接引用发送，持有到收到完成通知为止
+    void send(const std::shared_ptr<const std::string>& payload);
+
+    static const size_t kDefaultZeroCopyThreshold = 32 * 1024;
+    // 对send(shared_ptr)发送的大块数据使用MSG_ZEROCOPY，省掉拷贝进内核的开销，内核不支持时保持关闭
+    // 完成通知显示内核仍然做了拷贝时(例如回环地址、网卡不支持分散/聚集)自动关闭
+    void setZeroCopy(bool on, size_t threshold = kDefaultZeroCopyThreshold);
+    bool zeroCopy() const { return zeroCopyThreshold_ > 0; }
     // 关闭当前连接
     void shutdown();
+    // 强制关闭当前连接，不等待输出缓冲区中的数据发送完
+    void forceClose();
+
+    // 暂停/恢复读取，可以在任意线程调用
+    // 暂停期间对端继续发送的数据留在内核接收缓冲区，填满后TCP窗口关闭，对端自然被限速
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
+
+    // 流量控制：本连接输出缓冲区中待发送数据超过highMark时暂停upstream的读取，降到lowMark以下时恢复
+    // 例如转发时在下游连接上设置，upstream为上游连接，每个连接占用的内存就有了上界；upstream也可以是自己
+    // 只持有upstream的weak_ptr；本连接关闭时如果处于暂停状态会恢复upstream的读取；highMark为0表示关闭
+    void setFlowControl(const TcpConnectionPtr& upstream, size_t highMark, size_t lowMark);
+
+    // 开启边沿触发模式，必须在connectEstablished之前调用，poller不支持时保持水平触发
+    void setEdgeTriggered(bool on);
+
+    // 设置空闲超时，超过seconds秒没有读写任何数据则强制关闭连接，seconds <= 0表示不检测
+    void setIdleTimeout(double seconds);
+    // 设置写超时，输出缓冲区有待发送数据但超过seconds秒没有写出任何数据则强制关闭连接，seconds <= 0表示不检测
+    void setWriteTimeout(double seconds);
 
     // 建立连接
     void connectEstablished();
@@ -80,18 +126,55 @@ private:
         state_ = state;
     }
 
+    static const size_t kEdgeTriggeredReadBudget = 256 * 1024;  // 边沿触发模式下一次事件最多读取的字节数
+    static const size_t kEdgeTriggeredWriteBudget = 1024 * 1024; // 边沿触发模式下一次事件最多写出的字节数
+    static const int kZeroCopyLingerSeconds = 30;   // 连接销毁时还没收到完成通知的MSG_ZEROCOPY切片延后释放的秒数
+
     void handleRead(Timestamp receiveTime);
+    void handleReadEdgeTriggered(Timestamp receiveTime);
     void handleWrite();
+    void handleWriteEdgeTriggered();
+    // 输出缓冲区发送完：停止关注可写事件，回调writeCompleteCallback_，正在关闭时shutdown
+    void handleWriteComplete();
     void handleClose();
     void handleError();
 
     void sendInLoop(const void* data, size_t len);
+    // 在其他线程发送时，把data移进投递给loop线程的回调
+    void queueSend(std::string&& data);
+    void sendvInLoop(const struct iovec* iov, int iovcnt);
+    // 接管fd
+    void sendFileInLoop(int fd, off_t offset, size_t length);
+    void sendSharedInLoop(const std::shared_ptr<const std::string>& payload);
+    void setZeroCopyInLoop(bool on, size_t threshold);
+    void startReadInLoop();
+    void stopReadInLoop();
+    void setFlowControlInLoop(const std::weak_ptr<TcpConnection>& upstream, size_t highMark, size_t lowMark);
+    // 输出缓冲区中有待发送的数据，开始关注可写事件
+    void startWriting();
+    // 输出缓冲区长度变化后调用，跨过高低水位时暂停或恢复upstream的读取
+    void updateFlowControl();
+    // 读取socket错误队列，处理MSG_ZEROCOPY的完成通知
+    void handleErrorQueue();
+    // 连接销毁时调用，还在等待完成通知的切片交给loop延后释放，不随outputBuffer_一起释放
+    void releaseZeroCopyPending();
     void shutdownInLoop();
+    void forceCloseInLoop();
+
+    void setIdleTimeoutInLoop(double seconds);
+    void setWriteTimeoutInLoop(double seconds);
+    // 时间轮上的节点超时
+    void handleIdleTimeout();
+    void handleWriteTimeout();
+    // 有数据读写时调用，刷新时间轮上的超时时间
+    void touchIdle();
+    void touchWrite();
+    void cancelTimeouts();
 
     EventLoop* loop_;   // 多线程模式下，这个loop一定是subLoop
     const std::string name_;
     std::atomic_int state_; // 对应上面的枚举 StateE
-    bool reading_;
+    bool reading_;          // 是否在读取，stopRead后为false
 
     // 这里和Accept类似，Accept是在mainLoop里的，TcpConnection是在SubLoop里的
     std::unique_ptr<Socket> socket_;
@@ -108,7 +191,18 @@ private:
 
     size_t highWaterMark_;
     Buffer inputBuffer_;
-    Buffer outputBuffer_;
+    ChainBuffer outputBuffer_;     // 由定长块和外部切片串成，handleWrite用writev发送
+    std::atomic<size_t> zeroCopyThreshold_;    // 0表示不使用MSG_ZEROCOPY
+
+    std::weak_ptr<TcpConnection> flowUpstream_;     // 输出缓冲区积压时要暂停读取的连接
+    size_t flowHighMark_;       // 0表示不做流量控制
+    size_t flowLowMark_;
+    bool flowPaused_;           // 是否已经暂停了flowUpstream_的读取
+
+    double idleTimeout_;                // 空闲超时时间，单位秒
+    double writeTimeout_;               // 写超时时间，单位秒
+    TimingWheel::Node idleNode_;        // 挂在loop_的时间轮上
+    TimingWheel::Node writeNode_;
 };
 
 #endif
\ No newline at end of file
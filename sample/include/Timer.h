@@ -0,0 +1,41 @@
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+#include <atomic>
+
+// 定时器，封装了超时时间点、超时回调以及重复定时器的间隔
+class Timer : noncopyable {
+public:
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb))
+        , expiration_(when)
+        , interval_(interval)
+        , repeat_(interval > 0.0)
+        , sequence_(++numCreated_)
+    {}
+
+    // 超时后由TimerQueue调用
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 重复定时器重新计算下一次超时时间
+    void restart(Timestamp now);
+
+    static int64_t numCreated() { return numCreated_; }
+private:
+    const TimerCallback callback_;
+    Timestamp expiration_;      // 超时时间点
+    const double interval_;     // 重复间隔，单位秒
+    const bool repeat_;         // 是否为重复定时器
+    const int64_t sequence_;    // 全局唯一序号，配合Timer*区分定时器
+
+    static std::atomic<int64_t> numCreated_;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef __TIMERID_H__
+#define __TIMERID_H__
+
+#include <stdint.h>
+
+class Timer;
+
+// 对外暴露的定时器标识，EventLoop::runAt等接口返回，用于取消定时器
+// Timer*可能被复用，因此需要sequence_共同确定一个定时器
+class TimerId {
+public:
+    TimerId()
+        : timer_(nullptr)
+        , sequence_(0)
+    {}
+
+    TimerId(Timer* timer, int64_t seq)
+        : timer_(timer)
+        , sequence_(seq)
+    {}
+
+    friend class TimerQueue;
+private:
+    Timer* timer_;
+    int64_t sequence_;
+};
+
+#endif
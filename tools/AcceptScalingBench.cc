@@ -0,0 +1,128 @@
+// 测量IO loop个数不同时服务器每秒能建立多少连接，比较MainLoop单独accept与kReusePort每个loop各自accept
+// 用法：AcceptScalingBench [connections] [clientThreads] [maxLoops] [port]
+// loop个数从1翻倍到maxLoops，每种配置起一个服务器，clientThreads个线程一共发起connections个连接，
+// 每个连接建立后立即以RST关闭(SO_LINGER为0)，避免客户端端口耗在TIME_WAIT上
+// 发起但还没被服务器接受的连接不超过kMaxInFlight个，单核机器上客户端会跑在服务器前面，
+// 填满accept队列之后被丢弃的SYN要等1秒才重传，测到的就不是accept的速度了
+// 计时到服务器的连接回调看到全部连接为止
+
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "TcpConnection.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const double kMaxWaitSeconds = 5.0;     // 客户端结束后最多再等这么久，个别连接可能在accept之前就被丢弃
+const int kMaxInFlight = 256;           // 小于listen的backlog
+
+double wallSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void connectClient(uint16_t port, int count, std::atomic<int>* issued, const std::atomic<int>* accepted) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    struct linger lingerOpt;
+    lingerOpt.l_onoff = 1;
+    lingerOpt.l_linger = 0;
+    for(int i = 0; i < count; i++) {
+        while(issued->load(std::memory_order_relaxed) - accepted->load(std::memory_order_relaxed) >= kMaxInFlight) {
+            sched_yield();
+        }
+        issued->fetch_add(1, std::memory_order_relaxed);
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            perror("connect");
+            exit(1);
+        }
+        ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof(lingerOpt));
+        ::close(fd);
+    }
+}
+
+// 在新线程中运行一个服务器，返回每秒建立的连接数
+double runOnce(uint16_t port, TcpServer::Option option, int loops, int connections, int clientThreads) {
+    double rate = 0;
+    std::thread server([&] {
+        EventLoop loop;
+        TcpServer acceptor(&loop, InetAddress(port), "AcceptScalingBench", option);
+        std::atomic<int> accepted(0);
+        std::atomic<int> issued(0);
+        acceptor.setConnectionCallback([&accepted](const TcpConnectionPtr& conn) {
+            if(conn->connected()) {
+                accepted.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        acceptor.setMessageCallback([](const TcpConnectionPtr&, Buffer* buf, Timestamp) { buf->retrieveAll(); });
+        acceptor.setThreadNum(loops);
+        acceptor.start();
+
+        int perThread = connections / clientThreads;
+        int expected = perThread * clientThreads;
+        double start = wallSeconds();
+        std::thread clients([=, &loop, &accepted, &issued, &rate] {
+            std::vector<std::thread> threads;
+            for(int i = 0; i < clientThreads; i++) {
+                threads.emplace_back(connectClient, port, perThread, &issued, &accepted);
+            }
+            for(std::thread& t : threads) {
+                t.join();
+            }
+            double clientsDone = wallSeconds();
+            while(accepted.load() < expected && wallSeconds() - clientsDone < kMaxWaitSeconds) {
+                usleep(100);
+            }
+            double elapsed = wallSeconds() - start;
+            rate = accepted.load() / elapsed;
+            if(accepted.load() < expected) {
+                fprintf(stderr, "only %d of %d connections reached the server\n", accepted.load(), expected);
+            }
+            loop.quit();
+        });
+        loop.loop();
+        clients.join();
+    });
+    server.join();
+    return rate;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int connections = argc > 1 ? atoi(argv[1]) : 20000;
+    int clientThreads = argc > 2 ? atoi(argv[2]) : 4;
+    int maxLoops = argc > 3 ? atoi(argv[3]) : 8;
+    uint16_t port = argc > 4 ? static_cast<uint16_t>(atoi(argv[4])) : 23510;
+
+    // 连接被RST关闭时TcpConnection会打印ERROR日志，这里全部关掉，否则测到的是写日志的速度
+    Logger::setLogLevel(FATAL);
+    printf("%d connections from %d client threads per run\n", connections, clientThreads);
+    printf("loops   main-loop accept/s   reuseport accept/s\n");
+    for(int loops = 1; loops <= maxLoops; loops *= 2) {
+        double single = runOnce(port, TcpServer::kNoReusePort, loops, connections, clientThreads);
+        double sharded = runOnce(port, TcpServer::kReusePort, loops, connections, clientThreads);
+        printf("%5d   %18.0f   %18.0f\n", loops, single, sharded);
+        fflush(stdout);
+    }
+    return 0;
+}
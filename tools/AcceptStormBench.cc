@@ -0,0 +1,150 @@
+// 模拟连接风暴，测量Acceptor每秒能处理多少个连接：每次可读事件只accept一个、批量accept，以及fd耗尽(EMFILE)时
+// 用法：AcceptStormBench [burst] [rounds] [batch] [port]
+// 每一轮先在loop不运行时发起burst个连接(不超过listen的backlog 1024)，让它们全部堆在accept队列中，
+// 然后启动loop开始计时，直到所有客户端都看到服务器关闭连接为止
+// 前两项服务器accept之后立即close；EMFILE一项在启动loop前把RLIMIT_NOFILE压到当前已用的fd数，
+// 所有accept都会失败，连接全部由Acceptor用预留的idleFd_接受并关闭
+// 同时给出每处理一个连接平均需要几次loop循环(即epoll_wait)
+
+#include "Acceptor.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+double wallSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 当前最小的空闲fd，RLIMIT_NOFILE设为它之后进程不能再打开新的fd
+int lowestFreeFd() {
+    int fd = ::dup(0);
+    ::close(fd);
+    return fd;
+}
+
+struct Result {
+    double perSecond;           // 每秒处理的连接数
+    double loopsPerConnection;  // 平均每个连接需要的loop循环次数
+};
+
+Result run(EventLoop* loop, uint16_t port, int burst, int rounds, bool exhaustFds) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    // 服务器关闭连接时客户端fd上出现EPOLLRDHUP，每个fd只通知一次
+    int epollfd = ::epoll_create1(EPOLL_CLOEXEC);
+    std::vector<int> clients(burst);
+    double seconds = 0;
+    uint64_t iterations = 0;
+
+    for(int round = 0; round < rounds; round++) {
+        for(int i = 0; i < burst; i++) {
+            clients[i] = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            // 回环地址上只要accept队列还有空位，三次握手由内核完成，不需要服务器运行
+            if(::connect(clients[i], reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+                perror("connect");
+                exit(1);
+            }
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLRDHUP | EPOLLONESHOT;
+            ::epoll_ctl(epollfd, EPOLL_CTL_ADD, clients[i], &event);
+        }
+
+        struct rlimit saved;
+        ::getrlimit(RLIMIT_NOFILE, &saved);
+        if(exhaustFds) {
+            struct rlimit limited = saved;
+            limited.rlim_cur = lowestFreeFd();
+            ::setrlimit(RLIMIT_NOFILE, &limited);
+        }
+
+        uint64_t iterationsBefore = loop->stats().snapshot().iterations;
+        double start = wallSeconds();
+        double end = start;
+        std::thread watcher([epollfd, burst, loop, &end] {
+            struct epoll_event events[256];
+            int closed = 0;
+            while(closed < burst) {
+                int n = ::epoll_wait(epollfd, events, 256, -1);
+                if(n > 0) {
+                    closed += n;
+                }
+            }
+            end = wallSeconds();
+            loop->quit();
+        });
+        loop->loop();
+        watcher.join();
+        seconds += end - start;
+        iterations += loop->stats().snapshot().iterations - iterationsBefore;
+
+        if(exhaustFds) {
+            ::setrlimit(RLIMIT_NOFILE, &saved);
+        }
+        for(int i = 0; i < burst; i++) {
+            ::close(clients[i]);    // close时自动从epollfd中删除
+        }
+    }
+    ::close(epollfd);
+
+    Result result;
+    result.perSecond = static_cast<double>(burst) * rounds / seconds;
+    result.loopsPerConnection = static_cast<double>(iterations) / (static_cast<double>(burst) * rounds);
+    return result;
+}
+
+void report(const char* name, const Result& result) {
+    printf("%-16s %9.0f accepts/s  %6.3f loop iterations per connection\n",
+           name, result.perSecond, result.loopsPerConnection);
+    fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int burst = argc > 1 ? atoi(argv[1]) : 1000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    int batch = argc > 3 ? atoi(argv[3]) : Acceptor::kDefaultAcceptBatch;
+    uint16_t port = argc > 4 ? static_cast<uint16_t>(atoi(argv[4])) : 23520;
+
+    // EMFILE时Acceptor每秒输出一行错误日志，其余日志关掉
+    Logger::setLogLevel(ERROR);
+    EventLoop loop;
+    Acceptor acceptor(&loop, InetAddress(port), false);
+    acceptor.setNewConnectionCallback([](int sockfd, const InetAddress&) { ::close(sockfd); });
+    acceptor.listen();
+
+    printf("%d connections per burst, %d rounds\n", burst, rounds);
+    acceptor.setAcceptBatch(1);
+    report("batch=1", run(&loop, port, burst, rounds, false));
+
+    char name[32];
+    acceptor.setAcceptBatch(batch);
+    snprintf(name, sizeof(name), "batch=%d", batch);
+    report(name, run(&loop, port, burst, rounds, false));
+
+    snprintf(name, sizeof(name), "batch=%d EMFILE", batch);
+    report(name, run(&loop, port, burst, rounds, true));
+    return 0;
+}
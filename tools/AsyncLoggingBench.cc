@@ -0,0 +1,145 @@
+// 多个IO loop同时写日志时每秒能输出多少条，比较直接fwrite到文件与AsyncLogging后端
+// 用法：AsyncLoggingBench [loops] [messagesPerLoop] [basename]
+// 起loops(默认8)个EventLoopThread，每个loop中用LOG_INFO连续写messagesPerLoop条日志，
+// 计时到所有loop写完并且日志都落到文件为止(同步方式fflush，异步方式stop)
+// 日志文件写在basename开头的路径下，默认/tmp/AsyncLoggingBench，运行结束后删除
+
+#include "AsyncLogging.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <glob.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+const off_t kRollSize = 1024*1024*1024;
+
+FILE* g_syncFile = nullptr;
+AsyncLogging* g_asyncLog = nullptr;
+
+void syncOutput(const char* msg, int len) {
+    fwrite(msg, 1, len, g_syncFile);
+}
+
+void syncFlush() {
+    fflush(g_syncFile);
+}
+
+void asyncOutput(const char* msg, int len) {
+    g_asyncLog->append(msg, len);
+}
+
+void asyncFlush() {
+}
+
+void stdoutOutput(const char* msg, int len) {
+    fwrite(msg, 1, len, stdout);
+}
+
+double wallSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 在每个loop中写messagesPerLoop条日志，全部写完后返回
+void logFromLoops(const std::vector<EventLoop*>& loops, int messagesPerLoop) {
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t done = 0;
+    for(size_t i = 0; i < loops.size(); i++) {
+        loops[i]->runInLoop([&, i] {
+            for(int j = 0; j < messagesPerLoop; j++) {
+                LOG_INFO("AsyncLoggingBench loop %zu message %d payload %s", i, j, "abcdefghijklmnopqrstuvwxyz");
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            done++;
+            cond.notify_one();
+        });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [&] { return done == loops.size(); });
+}
+
+void removeLogs(const std::string& basename) {
+    glob_t files;
+    if(::glob((basename + "*").c_str(), 0, nullptr, &files) == 0) {
+        for(size_t i = 0; i < files.gl_pathc; i++) {
+            ::unlink(files.gl_pathv[i]);
+        }
+    }
+    ::globfree(&files);
+}
+
+void report(const char* name, int numLoops, int messagesPerLoop, double seconds, uint64_t dropped) {
+    double total = static_cast<double>(numLoops) * messagesPerLoop;
+    printf("%-6s %9.0f messages/s  %6.2f s  %llu dropped\n",
+           name, total / seconds, seconds, static_cast<unsigned long long>(dropped));
+    fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int numLoops = argc > 1 ? atoi(argv[1]) : 8;
+    int messagesPerLoop = argc > 2 ? atoi(argv[2]) : 200000;
+    std::string basename = argc > 3 ? argv[3] : "/tmp/AsyncLoggingBench";
+
+    // loop启动、退出时的日志不计入
+    Logger::setLogLevel(ERROR);
+    std::vector<std::unique_ptr<EventLoopThread>> threads;
+    std::vector<EventLoop*> loops;
+    for(int i = 0; i < numLoops; i++) {
+        threads.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(), "bench"));
+        loops.push_back(threads.back()->startLoop());
+    }
+    printf("%d loops x %d messages\n", numLoops, messagesPerLoop);
+
+    // 同步: 每条日志在IO线程中直接fwrite到文件
+    std::string syncPath = basename + ".sync.log";
+    g_syncFile = ::fopen(syncPath.c_str(), "w");
+    if(g_syncFile == nullptr) {
+        perror(syncPath.c_str());
+        return 1;
+    }
+    Logger::setOutput(syncOutput);
+    Logger::setFlush(syncFlush);
+    Logger::setLogLevel(INFO);
+    double start = wallSeconds();
+    logFromLoops(loops, messagesPerLoop);
+    ::fflush(g_syncFile);
+    report("fwrite", numLoops, messagesPerLoop, wallSeconds() - start, 0);
+    Logger::setLogLevel(ERROR);
+    ::fclose(g_syncFile);
+    g_syncFile = nullptr;
+
+    // 异步: IO线程只拷贝进AsyncLogging的缓冲区，后台线程写文件
+    std::string asyncBase = basename + ".async";
+    AsyncLogging asyncLog(asyncBase, kRollSize);
+    g_asyncLog = &asyncLog;
+    asyncLog.start();
+    Logger::setOutput(asyncOutput);
+    Logger::setFlush(asyncFlush);
+    Logger::setLogLevel(INFO);
+    start = wallSeconds();
+    logFromLoops(loops, messagesPerLoop);
+    Logger::setLogLevel(ERROR);
+    asyncLog.stop();
+    Logger::setOutput(stdoutOutput);
+    report("async", numLoops, messagesPerLoop, wallSeconds() - start, asyncLog.droppedMessages());
+
+    threads.clear();
+    removeLogs(basename);
+    return 0;
+}
@@ -0,0 +1,296 @@
+// 把BinaryLogging写出的二进制日志还原成文本
+// 用法：BinaryLogDecoder server.blog > server.log
+
+#include "BinaryLogging.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Site {
+    uint32_t level;
+    uint32_t line;
+    std::vector<uint8_t> types;
+    std::string file;
+    std::string fmt;
+};
+
+const char* const kLevelNames[] = { "[DEBUG]", "[INFO]", "[ERROR]", "[FATAL]" };
+
+bool readBytes(FILE* fp, void* buf, size_t len) {
+    return fread(buf, 1, len, fp) == len;
+}
+
+bool readU32(FILE* fp, uint32_t* v) {
+    return readBytes(fp, v, sizeof(*v));
+}
+
+bool readString(FILE* fp, std::string* s) {
+    uint32_t len = 0;
+    if(!readU32(fp, &len)) {
+        return false;
+    }
+    s->resize(len);
+    return len == 0 || readBytes(fp, &(*s)[0], len);
+}
+
+// 整数参数编码时统一扩展成了64位，按格式串中的长度修饰符截断回原来的宽度
+// 格式串经过编译器检查，修饰符与实参类型一致，例如%x对应的负int要还原成32位的ffffffff
+int lengthBits(const std::string& length) {
+    if(length == "hh") {
+        return 8;
+    }
+    else if(length == "h") {
+        return 16;
+    }
+    else if(length.empty()) {
+        return static_cast<int>(sizeof(int) * 8);
+    }
+    else if(length == "l") {
+        return static_cast<int>(sizeof(long) * 8);
+    }
+    else if(length == "z") {
+        return static_cast<int>(sizeof(size_t) * 8);
+    }
+    else if(length == "t") {
+        return static_cast<int>(sizeof(ptrdiff_t) * 8);
+    }
+    return 64;  // ll q j
+}
+
+unsigned long long truncateUnsigned(uint64_t raw, int bits) {
+    return bits >= 64 ? raw : raw & ((static_cast<uint64_t>(1) << bits) - 1);
+}
+
+long long truncateSigned(uint64_t raw, int bits) {
+    if(bits >= 64) {
+        return static_cast<long long>(raw);
+    }
+    uint64_t value = truncateUnsigned(raw, bits);
+    uint64_t signBit = static_cast<uint64_t>(1) << (bits - 1);
+    return static_cast<long long>((value ^ signBit) - signBit);   // 符号扩展
+}
+
+// 按照格式串和参数类型把一条记录格式化，转换说明逐个交给snprintf
+std::string format(const Site& site, const char* args, const char* end) {
+    std::string out;
+    const std::string& fmt = site.fmt;
+    size_t argIndex = 0;
+    char buf[512];
+
+    for(size_t i = 0; i < fmt.size(); i++) {
+        if(fmt[i] != '%') {
+            out += fmt[i];
+            continue;
+        }
+        if(i + 1 < fmt.size() && fmt[i + 1] == '%') {
+            out += '%';
+            i++;
+            continue;
+        }
+        // 解析 %[flags][width][.precision][length]conversion，长度修饰符单独记下，整数按它截断
+        std::string spec = "%";
+        std::string length;
+        size_t j = i + 1;
+        while(j < fmt.size() && strchr("-+ #0123456789.*", fmt[j])) {
+            spec += fmt[j++];
+        }
+        while(j < fmt.size() && strchr("hlLqjzt", fmt[j])) {
+            length += fmt[j++];
+        }
+        if(j >= fmt.size()) {
+            out += fmt.substr(i);
+            break;
+        }
+        char conv = fmt[j];
+        i = j;
+
+        if(argIndex >= site.types.size() || spec.find('*') != std::string::npos) {
+            out += spec;
+            out += length;
+            out += conv;
+            continue;
+        }
+        uint8_t type = site.types[argIndex++];
+        if(type == kBlogString) {
+            uint32_t len = 0;
+            if(end - args < static_cast<ptrdiff_t>(sizeof(len))) {
+                break;
+            }
+            memcpy(&len, args, sizeof(len));
+            args += sizeof(len);
+            if(end - args < static_cast<ptrdiff_t>(len)) {
+                break;
+            }
+            std::string str(args, args + len);
+            args += len;
+            if(spec.size() == 1) {
+                out += str;     // 没有宽度精度时直接拼接，不受buf长度限制
+            }
+            else {
+                snprintf(buf, sizeof(buf), (spec + 's').c_str(), str.c_str());
+                out += buf;
+            }
+            continue;
+        }
+
+        if(end - args < 8) {
+            break;
+        }
+        uint64_t raw = 0;
+        memcpy(&raw, args, 8);
+        args += 8;
+        if(type == kBlogDouble) {
+            double d;
+            memcpy(&d, &raw, 8);
+            if(strchr("eEfFgGaA", conv)) {
+                snprintf(buf, sizeof(buf), (spec + conv).c_str(), d);
+            }
+            else {
+                snprintf(buf, sizeof(buf), (spec + "lld").c_str(), static_cast<long long>(d));
+            }
+        }
+        else if(type == kBlogPointer || conv == 'p') {
+            snprintf(buf, sizeof(buf), (spec + 'p').c_str(), reinterpret_cast<void*>(static_cast<uintptr_t>(raw)));
+        }
+        else if(strchr("eEfFgGaA", conv)) {
+            snprintf(buf, sizeof(buf), (spec + conv).c_str(), static_cast<double>(static_cast<int64_t>(raw)));
+        }
+        else if(conv == 'c') {
+            snprintf(buf, sizeof(buf), (spec + 'c').c_str(), static_cast<int>(raw));
+        }
+        else if(conv == 's') {
+            snprintf(buf, sizeof(buf), (spec + "lld").c_str(), static_cast<long long>(raw));
+        }
+        else if(strchr("diuxXo", conv)) {
+            std::string s = spec + "ll" + conv;
+            int bits = lengthBits(length);
+            if(conv == 'd' || conv == 'i') {
+                snprintf(buf, sizeof(buf), s.c_str(), truncateSigned(raw, bits));
+            }
+            else {
+                snprintf(buf, sizeof(buf), s.c_str(), truncateUnsigned(raw, bits));
+            }
+        }
+        else {
+            snprintf(buf, sizeof(buf), "%s%c", spec.c_str(), conv);
+        }
+        out += buf;
+    }
+
+    // 与Logger一致，格式串自带的换行不重复
+    if(out.empty() || out[out.size() - 1] != '\n') {
+        out += '\n';
+    }
+    return out;
+}
+
+void printRecord(const blogfile::FileHeader& header, const std::vector<Site>& sites, uint32_t tid,
+                 const BinaryLogging::RecordHeader& rh, const char* args, const char* end) {
+    if(rh.siteId >= sites.size()) {
+        fprintf(stderr, "unknown site %u\n", rh.siteId);
+        return;
+    }
+    const Site& site = sites[rh.siteId];
+
+    double deltaNs = (static_cast<double>(rh.timestamp) - static_cast<double>(header.anchorTimestamp)) / header.ticksPerNs;
+    int64_t ns = header.anchorRealtimeNs + static_cast<int64_t>(deltaNs);
+    time_t seconds = static_cast<time_t>(ns / 1000000000);
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    char timebuf[64];
+    snprintf(timebuf, sizeof(timebuf), "%4d/%02d/%02d %02d:%02d:%02d.%06d",
+             tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+             tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<int>(ns % 1000000000 / 1000));
+
+    const char* base = strrchr(site.file.c_str(), '/');
+    base = base ? base + 1 : site.file.c_str();
+    std::string msg = format(site, args, end);
+    printf("%s%s %u %s:%u : %s", site.level < 4 ? kLevelNames[site.level] : "[?]",
+           timebuf, tid, base, site.line, msg.c_str());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s file.blog\n", argv[0]);
+        return 1;
+    }
+    FILE* fp = fopen(argv[1], "rb");
+    if(fp == nullptr) {
+        perror("fopen");
+        return 1;
+    }
+
+    blogfile::FileHeader header;
+    if(!readBytes(fp, &header, sizeof(header)) || memcmp(header.magic, blogfile::kMagic, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s: not a binary log file\n", argv[1]);
+        return 1;
+    }
+    if(header.ticksPerNs <= 0) {
+        header.ticksPerNs = 1.0;
+    }
+
+    std::vector<Site> sites;
+    std::vector<char> chunk;
+    uint8_t kind = 0;
+    while(readBytes(fp, &kind, 1)) {
+        if(kind == blogfile::kSiteDef) {
+            uint32_t id = 0, numArgs = 0;
+            Site site;
+            if(!readU32(fp, &id) || !readU32(fp, &site.level) || !readU32(fp, &site.line) || !readU32(fp, &numArgs)) {
+                break;
+            }
+            site.types.resize(numArgs);
+            if((numArgs > 0 && !readBytes(fp, &site.types[0], numArgs))
+                || !readString(fp, &site.file) || !readString(fp, &site.fmt)) {
+                break;
+            }
+            if(id >= sites.size()) {
+                sites.resize(id + 1);
+            }
+            sites[id] = site;
+        }
+        else if(kind == blogfile::kDropped) {
+            uint64_t n = 0;
+            if(!readBytes(fp, &n, sizeof(n))) {
+                break;
+            }
+            printf("*** %llu log messages dropped ***\n", static_cast<unsigned long long>(n));
+        }
+        else if(kind == blogfile::kRecords) {
+            uint32_t tid = 0, len = 0;
+            if(!readU32(fp, &tid) || !readU32(fp, &len)) {
+                break;
+            }
+            chunk.resize(len);
+            if(len > 0 && !readBytes(fp, &chunk[0], len)) {
+                break;
+            }
+            size_t pos = 0;
+            while(pos + sizeof(BinaryLogging::RecordHeader) <= chunk.size()) {
+                BinaryLogging::RecordHeader rh;
+                memcpy(&rh, &chunk[pos], sizeof(rh));
+                if(rh.size < sizeof(rh) || pos + rh.size > chunk.size()) {
+                    fprintf(stderr, "corrupted record\n");
+                    break;
+                }
+                const char* args = &chunk[pos] + sizeof(rh);
+                printRecord(header, sites, tid, rh, args, &chunk[pos] + rh.size);
+                pos += rh.size;
+            }
+        }
+        else {
+            fprintf(stderr, "corrupted entry kind %u\n", kind);
+            break;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
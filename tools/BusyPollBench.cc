@@ -0,0 +1,136 @@
+// 比较IO loop开启与不开启busy poll时，小消息回显的往返延迟分布(p50/p99/p999)
+// 用法：BusyPollBench [rounds] [payloadBytes] [gapUs] [maxSpinUs] [port]
+// 本进程中起两个只有一个IO线程的回显服务，端口分别为port和port + 1，后者开启setBusyPoll(maxSpinUs)
+// 客户端线程依次连接两个服务，每次发送payloadBytes字节并阻塞等回显，两次请求之间间隔gapUs微秒
+// 间隔短于自旋上限时，开启busy poll的loop在自旋中直接拿到请求，省掉epoll_wait阻塞与唤醒的开销
+// 需要空闲的CPU核，单核机器上自旋只会与客户端抢CPU
+
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "TcpConnection.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void spinFor(int64_t nanos) {
+    int64_t deadline = nowNanos() + nanos;
+    while(nowNanos() < deadline) {
+    }
+}
+
+void onConnection(const TcpConnectionPtr&) {
+}
+
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    conn->send(buf);
+}
+
+// 返回每次往返的延迟，单位纳秒
+std::vector<int64_t> pingPong(uint16_t port, int rounds, size_t payloadBytes, int gapUs) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    std::string request(payloadBytes, 'p');
+    std::unique_ptr<char[]> reply(new char[payloadBytes]);
+    std::vector<int64_t> latencies;
+    latencies.reserve(rounds);
+    for(int i = 0; i < rounds; i++) {
+        if(gapUs > 0) {
+            // 用自旋而不是usleep控制间隔，usleep本身的唤醒误差有几十微秒
+            spinFor(static_cast<int64_t>(gapUs) * 1000);
+        }
+        int64_t start = nowNanos();
+        if(::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) {
+            perror("write");
+            exit(1);
+        }
+        size_t got = 0;
+        while(got < payloadBytes) {
+            ssize_t n = ::read(fd, reply.get() + got, payloadBytes - got);
+            if(n <= 0) {
+                perror("read");
+                exit(1);
+            }
+            got += n;
+        }
+        latencies.push_back(nowNanos() - start);
+    }
+    ::close(fd);
+    return latencies;
+}
+
+void report(const char* name, std::vector<int64_t> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    size_t n = latencies.size();
+    printf("%-9s p50 %7.1f us  p99 %7.1f us  p999 %7.1f us  max %8.1f us\n", name,
+           latencies[n / 2] / 1e3, latencies[n * 99 / 100] / 1e3,
+           latencies[n * 999 / 1000] / 1e3, latencies[n - 1] / 1e3);
+    fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 100000;
+    size_t payloadBytes = argc > 2 ? atoi(argv[2]) : 64;
+    int gapUs = argc > 3 ? atoi(argv[3]) : 20;
+    int maxSpinUs = argc > 4 ? atoi(argv[4]) : 100;
+    uint16_t port = argc > 5 ? static_cast<uint16_t>(atoi(argv[5])) : 23490;
+
+    Logger::setLogLevel(ERROR);
+    EventLoop loop;
+    TcpServer blocking(&loop, InetAddress(port), "BlockingEcho");
+    TcpServer spinning(&loop, InetAddress(static_cast<uint16_t>(port + 1)), "BusyPollEcho");
+    blocking.setConnectionCallback(onConnection);
+    spinning.setConnectionCallback(onConnection);
+    blocking.setMessageCallback(onMessage);
+    spinning.setMessageCallback(onMessage);
+    blocking.setThreadNum(1);
+    spinning.setThreadNum(1);
+    spinning.setBusyPoll(maxSpinUs);
+    blocking.start();
+    spinning.start();
+
+    printf("%d rounds, %zu byte payload, %d us gap, busy poll up to %d us\n",
+           rounds, payloadBytes, gapUs, maxSpinUs);
+    std::thread client([&] {
+        report("epoll", pingPong(port, rounds, payloadBytes, gapUs));
+        report("busypoll", pingPong(static_cast<uint16_t>(port + 1), rounds, payloadBytes, gapUs));
+        loop.quit();
+    });
+    loop.loop();
+    client.join();
+    return 0;
+}
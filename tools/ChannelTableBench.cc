@@ -0,0 +1,128 @@
+// 比较Poller使用的ChannelTable与原来的unordered_map<int, Channel*>，在10k/100k/1M个fd时添加、修改、删除的开销
+// 用法：ChannelTableBench [lookupsPerFd] [repeat]
+// 添加: 按内核分配fd的方式从小到大插入；修改: 每个fd查找lookupsPerFd次，对应updateChannel与事件分发时的查找；
+// 删除: 全部移除。每项取repeat次中最快的一次，给出每次操作的平均纳秒数
+// fd个数超过进程的文件描述符上限，这里只测映射表本身，Channel指针是伪造的，不会被访问
+
+#include "ChannelTable.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unordered_map>
+
+class Channel;
+
+namespace {
+
+double wallSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+Channel* fakeChannel(int fd) {
+    return reinterpret_cast<Channel*>(static_cast<uintptr_t>(fd + 1) * 64);
+}
+
+struct Result {
+    double addNs;
+    double modifyNs;
+    double removeNs;
+};
+
+// 防止查找被优化掉
+uintptr_t g_sink = 0;
+
+void keepFastest(Result* best, const Result& r) {
+    if(r.addNs < best->addNs) {
+        best->addNs = r.addNs;
+    }
+    if(r.modifyNs < best->modifyNs) {
+        best->modifyNs = r.modifyNs;
+    }
+    if(r.removeNs < best->removeNs) {
+        best->removeNs = r.removeNs;
+    }
+}
+
+Result runTable(int numFds, int lookups) {
+    ChannelTable table;
+    Result result;
+    double start = wallSeconds();
+    for(int fd = 0; fd < numFds; fd++) {
+        table.insert(fd, fakeChannel(fd));
+    }
+    double added = wallSeconds();
+    uintptr_t sum = 0;
+    for(int i = 0; i < lookups; i++) {
+        for(int fd = 0; fd < numFds; fd++) {
+            sum += reinterpret_cast<uintptr_t>(table.find(fd));
+        }
+    }
+    double modified = wallSeconds();
+    for(int fd = 0; fd < numFds; fd++) {
+        table.erase(fd);
+    }
+    double removed = wallSeconds();
+    g_sink += sum + table.size();
+
+    result.addNs = (added - start) * 1e9 / numFds;
+    result.modifyNs = (modified - added) * 1e9 / (static_cast<double>(numFds) * lookups);
+    result.removeNs = (removed - modified) * 1e9 / numFds;
+    return result;
+}
+
+Result runHashMap(int numFds, int lookups) {
+    std::unordered_map<int, Channel*> channels;
+    Result result;
+    double start = wallSeconds();
+    for(int fd = 0; fd < numFds; fd++) {
+        channels[fd] = fakeChannel(fd);
+    }
+    double added = wallSeconds();
+    uintptr_t sum = 0;
+    for(int i = 0; i < lookups; i++) {
+        for(int fd = 0; fd < numFds; fd++) {
+            auto it = channels.find(fd);
+            if(it != channels.end()) {
+                sum += reinterpret_cast<uintptr_t>(it->second);
+            }
+        }
+    }
+    double modified = wallSeconds();
+    for(int fd = 0; fd < numFds; fd++) {
+        channels.erase(fd);
+    }
+    double removed = wallSeconds();
+    g_sink += sum + channels.size();
+
+    result.addNs = (added - start) * 1e9 / numFds;
+    result.modifyNs = (modified - added) * 1e9 / (static_cast<double>(numFds) * lookups);
+    result.removeNs = (removed - modified) * 1e9 / numFds;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int lookups = argc > 1 ? atoi(argv[1]) : 10;
+    int repeat = argc > 2 ? atoi(argv[2]) : 5;
+
+    printf("ns per operation, %d lookups per fd, fastest of %d runs\n", lookups, repeat);
+    printf("%8s  %-13s %8s %8s %8s\n", "fds", "map", "add", "modify", "remove");
+    const int sizes[] = { 10000, 100000, 1000000 };
+    for(int numFds : sizes) {
+        Result table = { 1e30, 1e30, 1e30 };
+        Result hashMap = { 1e30, 1e30, 1e30 };
+        for(int i = 0; i < repeat; i++) {
+            keepFastest(&table, runTable(numFds, lookups));
+            keepFastest(&hashMap, runHashMap(numFds, lookups));
+        }
+        printf("%8d  %-13s %8.1f %8.1f %8.1f\n", numFds, "ChannelTable", table.addNs, table.modifyNs, table.removeNs);
+        printf("%8s  %-13s %8.1f %8.1f %8.1f\n", "", "unordered_map", hashMap.addNs, hashMap.modifyNs, hashMap.removeNs);
+        fflush(stdout);
+    }
+    return g_sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+// 比较epoll与io_uring两种Poller后端上回显服务的吞吐量和服务端loop线程的CPU开销
+// 用法：IoUringBench [conns] [rounds] [payloadBytes] [port]
+// 依次以两种后端各起一个单线程回显服务(第二次设置MUDUO_USE_IO_URING)，conns个客户端线程
+// 各自阻塞地发送payloadBytes字节、等待回显，重复rounds次
+// 内核不支持io_uring时第二项会退回epoll，输出中的backend一栏给出实际使用的后端
+
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "TcpConnection.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+double threadCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double wallSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void onConnection(const TcpConnectionPtr&) {
+}
+
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    conn->send(buf);
+}
+
+void echoClient(uint16_t port, int rounds, size_t payloadBytes) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    std::string request(payloadBytes, 'u');
+    std::unique_ptr<char[]> reply(new char[payloadBytes]);
+    for(int i = 0; i < rounds; i++) {
+        if(::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) {
+            perror("write");
+            exit(1);
+        }
+        size_t got = 0;
+        while(got < payloadBytes) {
+            ssize_t n = ::read(fd, reply.get() + got, payloadBytes - got);
+            if(n <= 0) {
+                perror("read");
+                exit(1);
+            }
+            got += n;
+        }
+    }
+    ::close(fd);
+}
+
+// 在新线程中创建loop，这样loop构造时才会按当前的环境变量选择Poller
+void runOnce(uint16_t port, int conns, int rounds, size_t payloadBytes) {
+    std::thread server([=] {
+        EventLoop loop;
+        TcpServer echo(&loop, InetAddress(port), "IoUringBench");
+        echo.setConnectionCallback(onConnection);
+        echo.setMessageCallback(onMessage);
+        echo.start();
+
+        double cpuStart = threadCpuSeconds();
+        double wallStart = wallSeconds();
+        std::thread clients([=, &loop] {
+            std::vector<std::thread> threads;
+            for(int i = 0; i < conns; i++) {
+                threads.emplace_back(echoClient, port, rounds, payloadBytes);
+            }
+            for(std::thread& t : threads) {
+                t.join();
+            }
+            loop.quit();
+        });
+        loop.loop();
+        clients.join();
+        double cpu = threadCpuSeconds() - cpuStart;
+        double wall = wallSeconds() - wallStart;
+
+        LoopStats::Snapshot stats = loop.stats().snapshot();
+        double total = static_cast<double>(conns) * rounds;
+        printf("%-9s %9.0f round trips/s  loop cpu %6.2f us/round trip  %9llu iterations  %7llu epoll_ctl\n",
+               loop.supportsEdgeTriggered() ? "epoll" : "io_uring", total / wall, cpu * 1e6 / total,
+               static_cast<unsigned long long>(stats.iterations),
+               static_cast<unsigned long long>(stats.epollCtls));
+        fflush(stdout);
+    });
+    server.join();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int conns = argc > 1 ? atoi(argv[1]) : 4;
+    int rounds = argc > 2 ? atoi(argv[2]) : 50000;
+    size_t payloadBytes = argc > 3 ? atoi(argv[3]) : 64;
+    uint16_t port = argc > 4 ? static_cast<uint16_t>(atoi(argv[4])) : 23500;
+
+    Logger::setLogLevel(ERROR);
+    printf("%d conns x %d round trips, %zu byte payload\n", conns, rounds, payloadBytes);
+    ::unsetenv("MUDUO_USE_IO_URING");
+    runOnce(port, conns, rounds, payloadBytes);
+    ::setenv("MUDUO_USE_IO_URING", "1", 1);
+    runOnce(static_cast<uint16_t>(port + 1), conns, rounds, payloadBytes);
+    return 0;
+}
@@ -0,0 +1,127 @@
+// 比较EventLoop使用的无锁MpscQueue与原来mutex + vector的pendingFunctors_，多个生产者同时入队时的吞吐量
+// 用法：MpscQueueBench [totalPushes] [maxProducers]
+// 生产者线程数从1翻倍到maxProducers(默认32)，总入队次数固定，由一个消费者线程像doPendingFunctors那样批量取出执行
+// 每一项给出总吞吐量(百万次/秒)和生产者平均每次入队花费的时间
+
+#include "MpscQueue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Functor = std::function<void()>;
+
+double wallSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double threadCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 改用MpscQueue之前EventLoop的做法: 入队加锁，消费者加锁swap出来之后在锁外执行
+class MutexQueue {
+public:
+    void push(Functor cb) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        functors_.emplace_back(std::move(cb));
+    }
+
+    template<typename Func>
+    size_t consume(Func func) {
+        std::vector<Functor> functors;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            functors.swap(functors_);
+        }
+        for(Functor& cb : functors) {
+            func(cb);
+        }
+        return functors.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Functor> functors_;
+};
+
+struct Result {
+    double mops;            // 总吞吐量，百万次/秒
+    double nsPerPush;       // 生产者平均每次入队消耗的CPU时间
+};
+
+template<typename Queue>
+Result run(int producers, long total) {
+    Queue queue;
+    long perProducer = total / producers;
+    long expected = perProducer * producers;
+    std::atomic<long> executed(0);
+    std::atomic<long> producerNanos(0);
+
+    double start = wallSeconds();
+    std::thread consumer([&queue, expected] {
+        long n = 0;
+        while(n < expected) {
+            size_t got = queue.consume([](Functor& cb) { cb(); });
+            if(got == 0) {
+                std::this_thread::yield();
+            }
+            n += static_cast<long>(got);
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < producers; i++) {
+        threads.emplace_back([&queue, &executed, &producerNanos, perProducer] {
+            double cpuStart = threadCpuSeconds();
+            for(long j = 0; j < perProducer; j++) {
+                queue.push([&executed] { executed.fetch_add(1, std::memory_order_relaxed); });
+            }
+            producerNanos.fetch_add(static_cast<long>((threadCpuSeconds() - cpuStart) * 1e9),
+                                    std::memory_order_relaxed);
+        });
+    }
+    for(std::thread& t : threads) {
+        t.join();
+    }
+    consumer.join();
+    double wall = wallSeconds() - start;
+
+    if(executed.load() != expected) {
+        fprintf(stderr, "lost functors: executed %ld of %ld\n", executed.load(), expected);
+        exit(1);
+    }
+    Result result;
+    result.mops = expected / wall / 1e6;
+    result.nsPerPush = static_cast<double>(producerNanos.load()) / expected;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    long total = argc > 1 ? atol(argv[1]) : 4000000;
+    int maxProducers = argc > 2 ? atoi(argv[2]) : 32;
+
+    printf("%d cpus, %ld pushes per run\n", static_cast<int>(std::thread::hardware_concurrency()), total);
+    printf("producers   mutex Mops/s  ns/push   mpsc Mops/s  ns/push\n");
+    for(int producers = 1; producers <= maxProducers; producers *= 2) {
+        Result mutex = run<MutexQueue>(producers, total);
+        Result mpsc = run<MpscQueue<Functor>>(producers, total);
+        printf("%9d   %12.2f  %7.1f   %11.2f  %7.1f\n",
+               producers, mutex.mops, mutex.nsPerPush, mpsc.mops, mpsc.nsPerPush);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,172 @@
+// 比较Buffer::readFd改用暂存区和readHint_前后，每次读取的耗时
+// 用法：ReadFdBench [iterations] [repeat]
+// 通过AF_UNIX socketpair，每次写入一条64B或16KB的消息，再用readFd一次读完并retrieveAll
+// before: 原来的实现，vector存储，每次调用在栈上清零64KB的extrabuf，不预估读取量
+// stack:  readFd(fd, &err)，栈上暂存区不清零，按readHint_预先扩充可写空间
+// staging: readFd(fd, &err, staging, len)，使用EventLoop持有的暂存区，TcpConnection走这条路径
+// 只统计readFd本身的时间，每项取repeat次中最快的一次，给出每次读取的平均微秒数
+
+#include "Buffer.h"
+#include "EventLoop.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+
+double wallSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 改动之前Buffer的读路径，只保留readFd用到的部分
+class LegacyBuffer {
+public:
+    static const size_t kCheapPrepend = 8;
+    static const size_t kInitialSize = 1024;
+
+    LegacyBuffer()
+        : buffer_(kCheapPrepend + kInitialSize)
+        , readerIndex_(kCheapPrepend)
+        , writerIndex_(kCheapPrepend)
+    {}
+
+    size_t readableBytes() const { return writerIndex_ - readerIndex_; }
+    size_t writableBytes() const { return buffer_.size() - writerIndex_; }
+
+    void retrieveAll() {
+        readerIndex_ = kCheapPrepend;
+        writerIndex_ = kCheapPrepend;
+    }
+
+    void append(const char* data, size_t len) {
+        if(writableBytes() < len) {
+            makeSpace(len);
+        }
+        std::copy(data, data + len, &buffer_[writerIndex_]);
+        writerIndex_ += len;
+    }
+
+    ssize_t readFd(int fd, int* saveErrno) {
+        char extrabuf[65536] = {0}; // 64k
+
+        iovec vec[2];
+
+        const size_t writable = writableBytes();
+        vec[0].iov_base = &buffer_[writerIndex_];
+        vec[0].iov_len = writable;
+
+        vec[1].iov_base = extrabuf;
+        vec[1].iov_len = sizeof(extrabuf);
+
+        const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+        const ssize_t n = ::readv(fd, vec, iovcnt);
+        if(n < 0) {
+            *saveErrno = errno;
+        }
+        else if(static_cast<size_t>(n) <= writable) {
+            writerIndex_ += n;
+        }
+        else {
+            writerIndex_ = buffer_.size();
+            append(extrabuf, n - writable);
+        }
+        return n;
+    }
+
+private:
+    void makeSpace(size_t len) {
+        if(writableBytes() + readerIndex_ < len + kCheapPrepend) {
+            buffer_.resize(writerIndex_ + len);
+        }
+        else {
+            size_t readable = readableBytes();
+            std::copy(&buffer_[readerIndex_], &buffer_[writerIndex_], &buffer_[kCheapPrepend]);
+            readerIndex_ = kCheapPrepend;
+            writerIndex_ = readerIndex_ + readable;
+        }
+    }
+
+    std::vector<char> buffer_;
+    size_t readerIndex_;
+    size_t writerIndex_;
+};
+
+enum Mode { kBefore, kStack, kStaging };
+
+// 写一条消息，读一次，返回平均每次readFd的秒数
+double run(Mode mode, size_t msgSize, int iterations) {
+    int fds[2];
+    if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+        perror("socketpair");
+        exit(1);
+    }
+    std::vector<char> message(msgSize, 'x');
+    std::unique_ptr<char[]> staging(new char[EventLoop::kReadStagingSize]);
+    LegacyBuffer legacy;
+    Buffer buffer;
+
+    double seconds = 0;
+    for(int i = 0; i < iterations; i++) {
+        if(::write(fds[0], message.data(), msgSize) != static_cast<ssize_t>(msgSize)) {
+            perror("write");
+            exit(1);
+        }
+        int err = 0;
+        ssize_t n = 0;
+        double start = wallSeconds();
+        switch(mode) {
+        case kBefore:
+            n = legacy.readFd(fds[1], &err);
+            legacy.retrieveAll();
+            break;
+        case kStack:
+            n = buffer.readFd(fds[1], &err);
+            buffer.retrieveAll();
+            break;
+        case kStaging:
+            n = buffer.readFd(fds[1], &err, staging.get(), EventLoop::kReadStagingSize);
+            buffer.retrieveAll();
+            break;
+        }
+        seconds += wallSeconds() - start;
+        if(n != static_cast<ssize_t>(msgSize)) {
+            fprintf(stderr, "short read %zd of %zu\n", n, msgSize);
+            exit(1);
+        }
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return seconds / iterations;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    int repeat = argc > 2 ? atoi(argv[2]) : 5;
+
+    printf("us per readFd, %d reads, fastest of %d runs\n", iterations, repeat);
+    printf("%8s %10s %10s %10s\n", "size", "before", "stack", "staging");
+    const size_t sizes[] = { 64, 16*1024 };
+    for(size_t msgSize : sizes) {
+        double best[3] = { 1e30, 1e30, 1e30 };
+        for(int i = 0; i < repeat; i++) {
+            for(int mode = kBefore; mode <= kStaging; mode++) {
+                best[mode] = std::min(best[mode], run(static_cast<Mode>(mode), msgSize, iterations));
+            }
+        }
+        printf("%8zu %10.3f %10.3f %10.3f\n", msgSize, best[kBefore] * 1e6, best[kStack] * 1e6, best[kStaging] * 1e6);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+// 比较普通发送与MSG_ZEROCOPY发送，每GB数据消耗发送线程多少CPU时间
+// 用法：ZeroCopyBench [GB] [payloadKB] [port] [external]
+// 默认在本进程中起一个接收线程，依次用两种方式各接收一个连接的数据
+// 给出第4个参数时只监听端口，由其他机器连接并丢弃数据，例如 nc host port > /dev/null，
+// 连接按到达顺序交替使用两种方式；回环地址上内核总会退回拷贝，只有走真实网卡才看得出区别
+
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "TcpConnection.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace {
+
+const int kPayloadsPerRefill = 4;
+
+double threadCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double wallSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct Session {
+    bool zeroCopy;
+    bool done;
+    size_t sent;
+    double cpuStart;
+    double wallStart;
+};
+
+class Bench {
+public:
+    Bench(EventLoop* loop, const InetAddress& addr, size_t totalBytes, size_t payloadBytes)
+        : server_(loop, addr, "ZeroCopyBench")
+        , totalBytes_(totalBytes)
+        , payload_(std::make_shared<std::string>(payloadBytes, 'z'))
+        , connections_(0)
+    {
+        server_.setConnectionCallback(std::bind(&Bench::onConnection, this, std::placeholders::_1));
+        server_.setMessageCallback([](const TcpConnectionPtr&, Buffer* buf, Timestamp) { buf->retrieveAll(); });
+        server_.setWriteCompleteCallback(std::bind(&Bench::onWriteComplete, this, std::placeholders::_1));
+    }
+
+    void start() { server_.start(); }
+
+private:
+    void onConnection(const TcpConnectionPtr& conn) {
+        if(!conn->connected()) {
+            return;
+        }
+        session_.zeroCopy = (connections_++ % 2) == 1;
+        session_.done = false;
+        session_.sent = 0;
+        if(session_.zeroCopy) {
+            conn->setZeroCopy(true);
+        }
+        session_.cpuStart = threadCpuSeconds();
+        session_.wallStart = wallSeconds();
+        refill(conn);
+    }
+
+    void onWriteComplete(const TcpConnectionPtr& conn) {
+        if(session_.done) {
+            return;
+        }
+        if(session_.sent < totalBytes_) {
+            refill(conn);
+            return;
+        }
+        session_.done = true;
+        double cpu = threadCpuSeconds() - session_.cpuStart;
+        double wall = wallSeconds() - session_.wallStart;
+        double gb = session_.sent / 1e9;
+        printf("%-9s %6.2f GB in %6.2f s  %7.2f Gbit/s  sender cpu %7.1f ms/GB%s\n",
+               session_.zeroCopy ? "zerocopy" : "copy", gb, wall, gb * 8 / wall, cpu * 1000 / gb,
+               session_.zeroCopy && !conn->zeroCopy() ? "  (kernel copied, zerocopy turned off)" : "");
+        fflush(stdout);
+        conn->shutdown();
+    }
+
+    void refill(const TcpConnectionPtr& conn) {
+        for(int i = 0; i < kPayloadsPerRefill && session_.sent < totalBytes_; i++) {
+            conn->send(std::shared_ptr<const std::string>(payload_));
+            session_.sent += payload_->size();
+        }
+    }
+
+    TcpServer server_;
+    const size_t totalBytes_;
+    std::shared_ptr<std::string> payload_;
+    int connections_;
+    Session session_;
+};
+
+// 本进程中的接收端，读到对端关闭为止
+void sink(uint16_t port) {
+    std::unique_ptr<char[]> buf(new char[1 << 20]);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    while(::read(fd, buf.get(), 1 << 20) > 0) {
+    }
+    ::close(fd);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    double gb = argc > 1 ? atof(argv[1]) : 4.0;
+    size_t payloadKB = argc > 2 ? atoi(argv[2]) : 1024;
+    uint16_t port = argc > 3 ? static_cast<uint16_t>(atoi(argv[3])) : 23480;
+    bool external = argc > 4;
+
+    Logger::setLogLevel(ERROR);
+    EventLoop loop;
+    Bench bench(&loop, InetAddress(port), static_cast<size_t>(gb * 1e9), payloadKB * 1024);
+    bench.start();
+
+    std::thread client;
+    if(!external) {
+        client = std::thread([&loop, port] {
+            sink(port);     // 普通发送
+            sink(port);     // MSG_ZEROCOPY
+            loop.quit();
+        });
+    }
+    loop.loop();
+    if(client.joinable()) {
+        client.join();
+    }
+    return 0;
+}